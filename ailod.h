@@ -0,0 +1,68 @@
+#pragma once
+#include "mechanics.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Level of detail for enemy AI.
+// Each enemy move round puts every enemy in a bucket by distance from the
+// player, and the further away it is, the less often it is updated:
+//   near - a step every round, planned with A* when patrolling
+//   mid  - a step every 2nd round, planned with A* when patrolling
+//   far  - a step every 4th round, always greedy; a far patroller that runs
+//          into something waits rather than searching for a way round
+// An update is one step, so distant enemies move more slowly rather than
+// catching up in bursts. Updates are staggered by index so they spread over
+// the rounds.
+// A* path steps are the expensive part, and a round may plan at most
+// AI_PATHS_PER_ROUND of them. They go to the near bucket first. Within a
+// bucket they go in index order from `cursor`, which moves to the first
+// patroller that missed out, so patrollers in a bucket take turns. One over
+// the budget takes the greedy step towards its patrol point, or holds if
+// that is blocked.
+// Buckets use distance, not what the player can see: field of view is only
+// computed when a frame is drawn, and the simulation must not depend on it.
+enum AiLodLevel : uint8_t
+{
+    AI_LOD_NEAR,
+    AI_LOD_MID,
+    AI_LOD_FAR,
+    AI_LOD_LEVELS
+};
+
+const int AI_LOD_RANGE[AI_LOD_LEVELS - 1] = {24, 60}; // Upper distance of near and mid, in columns (rows count double)
+const int AI_LOD_INTERVAL[AI_LOD_LEVELS] = {1, 2, 4};  // Rounds between updates
+const int AI_PATHS_PER_ROUND = 1;                      // A* path steps one round may plan
+
+// Plain data; copied into snapshots as it is.
+struct AiLodState
+{
+    uint32_t round;
+    int16_t cursor; // Enemy with first claim on next round's path steps
+    int16_t reserved;
+};
+
+void resetAiLod(AiLodState &a)
+{
+    memset(&a, 0, sizeof(a));
+}
+
+AiLodLevel aiLodLevel(int dx, int dy)
+{
+    int distance = abs(dx) + 2 * abs(dy);
+    if (distance <= AI_LOD_RANGE[0])
+        return AI_LOD_NEAR;
+    return distance <= AI_LOD_RANGE[1] ? AI_LOD_MID : AI_LOD_FAR;
+}
+
+// Whether enemy i is updated this round.
+bool aiLodDue(const AiLodState &a, int i, AiLodLevel level)
+{
+    return (a.round + (uint32_t)i) % AI_LOD_INTERVAL[level] == 0;
+}
+
+// For state that came from outside, such as a save file.
+bool isAiLodValid(const AiLodState &a)
+{
+    return a.cursor >= 0 && a.cursor < MAX_ENEMIES;
+}
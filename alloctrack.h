@@ -0,0 +1,218 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#if defined(_WIN32) || defined(_WIN64)
+#include <malloc.h>
+#endif
+
+// Heap allocation tracking, for checking that the game loop doesn't allocate.
+// Build with -DROCKY_TRACK_ALLOCS to replace the global operator new/delete
+// with versions that count allocations and bytes, per frame and in total,
+// against the engine stage that is running (set with AllocStageScope). Once
+// armAllocGuard() is called, a debug build asserts on any allocation made by
+// that thread, except inside an AllocationsAllowed scope. Without the flag
+// everything here compiles to nothing.
+enum AllocStage
+{
+    ALLOC_STAGE_OTHER, // Setup, menus and loader threads
+    ALLOC_STAGE_INPUT,
+    ALLOC_STAGE_SIMULATION,
+    ALLOC_STAGE_EFFECTS,
+    ALLOC_STAGE_RENDER,
+    ALLOC_STAGE_COUNT
+};
+
+const char *const ALLOC_STAGE_NAMES[ALLOC_STAGE_COUNT] = {"other", "input", "simulation", "effects", "render"};
+const int ALLOC_WARMUP_FRAMES = 120; // Frames the loop may allocate in before the guard is armed
+
+#ifdef ROCKY_TRACK_ALLOCS
+
+struct AllocCounters
+{
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+struct AllocStats
+{
+    AllocCounters frame[ALLOC_STAGE_COUNT]; // Since the last endAllocFrame()
+    AllocCounters total[ALLOC_STAGE_COUNT];
+    std::atomic<uint64_t> frees{0};
+    uint64_t frames = 0;
+    uint64_t frames_with_allocs = 0;
+    uint64_t peak_frame_count = 0;
+};
+
+AllocStats allocStats;
+thread_local AllocStage alloc_stage = ALLOC_STAGE_OTHER;
+thread_local bool alloc_guard_armed = false;
+thread_local int alloc_allowed_depth = 0;
+
+void countAlloc(std::size_t size)
+{
+    allocStats.frame[alloc_stage].count.fetch_add(1, std::memory_order_relaxed);
+    allocStats.frame[alloc_stage].bytes.fetch_add(size, std::memory_order_relaxed);
+    assert((!alloc_guard_armed || alloc_allowed_depth > 0) && "Heap allocation in the game loop after warm-up");
+}
+
+void *trackedAlloc(std::size_t size)
+{
+    countAlloc(size);
+    return std::malloc(size ? size : 1);
+}
+
+void trackedFree(void *p)
+{
+    if (p)
+        allocStats.frees.fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+// Over-aligned types (alignas above the default) come through these.
+void *trackedAlignedAlloc(std::size_t size, std::align_val_t align)
+{
+    countAlloc(size);
+    std::size_t a = (std::size_t)align;
+#if defined(_WIN32) || defined(_WIN64)
+    return _aligned_malloc(size ? size : 1, a);
+#else
+    return std::aligned_alloc(a, size ? (size + a - 1) / a * a : a); // The size has to be a multiple of the alignment
+#endif
+}
+
+void trackedAlignedFree(void *p)
+{
+    if (p)
+        allocStats.frees.fetch_add(1, std::memory_order_relaxed);
+#if defined(_WIN32) || defined(_WIN64)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void *operator new(std::size_t size)
+{
+    void *p = trackedAlloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    void *p = trackedAlloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return trackedAlloc(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return trackedAlloc(size); }
+void operator delete(void *p) noexcept { trackedFree(p); }
+void operator delete[](void *p) noexcept { trackedFree(p); }
+void operator delete(void *p, std::size_t) noexcept { trackedFree(p); }
+void operator delete[](void *p, std::size_t) noexcept { trackedFree(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { trackedFree(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { trackedFree(p); }
+
+void *operator new(std::size_t size, std::align_val_t align)
+{
+    void *p = trackedAlignedAlloc(size, align);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size, std::align_val_t align)
+{
+    void *p = trackedAlignedAlloc(size, align);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept { return trackedAlignedAlloc(size, align); }
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept { return trackedAlignedAlloc(size, align); }
+void operator delete(void *p, std::align_val_t) noexcept { trackedAlignedFree(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { trackedAlignedFree(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { trackedAlignedFree(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { trackedAlignedFree(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { trackedAlignedFree(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept { trackedAlignedFree(p); }
+
+struct AllocStageScope
+{
+    AllocStage previous;
+    explicit AllocStageScope(AllocStage stage) : previous(alloc_stage) { alloc_stage = stage; }
+    ~AllocStageScope() { alloc_stage = previous; }
+};
+
+// For the few places the loop is allowed to allocate, e.g. starting the
+// thread that loads the next world.
+struct AllocationsAllowed
+{
+    AllocationsAllowed() { alloc_allowed_depth++; }
+    ~AllocationsAllowed() { alloc_allowed_depth--; }
+};
+
+void armAllocGuard(bool armed)
+{
+    alloc_guard_armed = armed;
+}
+
+// Folds this frame's counters into the totals.
+void endAllocFrame()
+{
+    uint64_t count = 0;
+    for (int s = 0; s < ALLOC_STAGE_COUNT; s++)
+    {
+        uint64_t c = allocStats.frame[s].count.exchange(0, std::memory_order_relaxed);
+        uint64_t b = allocStats.frame[s].bytes.exchange(0, std::memory_order_relaxed);
+        allocStats.total[s].count.fetch_add(c, std::memory_order_relaxed);
+        allocStats.total[s].bytes.fetch_add(b, std::memory_order_relaxed);
+        if (s != ALLOC_STAGE_OTHER)
+            count += c;
+    }
+    allocStats.frames++;
+    if (count > 0)
+        allocStats.frames_with_allocs++;
+    if (count > allocStats.peak_frame_count)
+        allocStats.peak_frame_count = count;
+}
+
+void printAllocReport(FILE *out)
+{
+    fprintf(out, "Allocations over %llu frames (%llu frames allocated, peak %llu in one frame, %llu frees):\n",
+            (unsigned long long)allocStats.frames, (unsigned long long)allocStats.frames_with_allocs,
+            (unsigned long long)allocStats.peak_frame_count, (unsigned long long)allocStats.frees.load());
+    for (int s = 0; s < ALLOC_STAGE_COUNT; s++)
+    {
+        fprintf(out, "  %-10s %10llu allocs %12llu bytes\n", ALLOC_STAGE_NAMES[s],
+                (unsigned long long)allocStats.total[s].count.load(), (unsigned long long)allocStats.total[s].bytes.load());
+    }
+}
+
+#else
+
+struct AllocStageScope
+{
+    explicit AllocStageScope(AllocStage) {}
+    ~AllocStageScope() {}
+};
+
+struct AllocationsAllowed
+{
+    AllocationsAllowed() {}
+    ~AllocationsAllowed() {}
+};
+
+void armAllocGuard(bool) {}
+void endAllocFrame() {}
+void printAllocReport(FILE *) {}
+
+#endif
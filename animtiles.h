@@ -0,0 +1,134 @@
+#pragma once
+#include "consoleGameEngine.h"
+#include "fov.h"
+#include "layers.h"
+#include <cstdint>
+#include <cstring>
+
+// Animated terrain: water ripples and flowers nod. The map itself never
+// changes (it is game state); animation frames are written straight into
+// the terrain layer, and the renderer only sends the cells that changed.
+// When a map is shown, its animated cells are listed once, grouped by phase:
+// a cell's phase comes from where it is, so neighbouring bands are out of
+// step and ripples seem to roll across the pond. Each animation step redraws
+// only the cells of one phase, so animated terrain costs a quarter of its
+// cells per step and nothing for the rest of the map.
+const int ANIM_PHASES = 4;
+const int ANIM_FRAMES = 4;
+const int ANIM_STEP_FRAMES = 12; // Drawn frames between steps; a cell changes every ANIM_PHASES steps
+
+struct AnimatedTile
+{
+    char glyph;         // Map glyph that animates
+    const char *frames; // ANIM_FRAMES glyphs; the first is the map glyph
+};
+
+const AnimatedTile ANIMATED_TILES[] = {
+    {'~', "~~-~"}, // Water
+    {'^', "^^^'"}, // Flowers
+};
+
+const int ANIMATED_TILE_KINDS = sizeof(ANIMATED_TILES) / sizeof(ANIMATED_TILES[0]);
+
+static_assert(WIDTH <= 256 && HEIGHT <= 256, "Animated cells store coordinates in bytes");
+
+struct AnimCell
+{
+    uint8_t x;
+    uint8_t y;
+    uint8_t kind; // Index into ANIMATED_TILES
+    uint8_t reserved;
+};
+
+struct AnimatedTiles
+{
+    AnimCell cells[HEIGHT * WIDTH]; // Cells of phase p are cells[start[p]] up to cells[start[p + 1]]
+    int start[ANIM_PHASES + 1];
+    uint8_t frame[ANIM_PHASES]; // Frame each phase is showing
+    uint32_t step = 0;
+};
+
+AnimatedTiles animatedTiles;
+
+int animPhase(int x, int y)
+{
+    return (x / 3 + y) % ANIM_PHASES;
+}
+
+int animatedKind(char tile)
+{
+    for (int k = 0; k < ANIMATED_TILE_KINDS; k++)
+    {
+        if (ANIMATED_TILES[k].glyph == tile)
+            return k;
+    }
+    return -1;
+}
+
+// Lists the animated cells of `tiles` by phase (a counting sort) and starts
+// every phase on its first frame, which is what the terrain already shows.
+void buildAnimatedTiles(AnimatedTiles &a, const char tiles[HEIGHT][WIDTH])
+{
+    int count[ANIM_PHASES] = {};
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        for (int x = 0; x < WIDTH; x++)
+        {
+            if (animatedKind(tiles[y][x]) >= 0)
+                count[animPhase(x, y)]++;
+        }
+    }
+    int next[ANIM_PHASES];
+    a.start[0] = 0;
+    for (int p = 0; p < ANIM_PHASES; p++)
+    {
+        next[p] = a.start[p];
+        a.start[p + 1] = a.start[p] + count[p];
+    }
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        for (int x = 0; x < WIDTH; x++)
+        {
+            int kind = animatedKind(tiles[y][x]);
+            if (kind >= 0)
+                a.cells[next[animPhase(x, y)]++] = {(uint8_t)x, (uint8_t)y, (uint8_t)kind, 0};
+        }
+    }
+    memset(a.frame, 0, sizeof(a.frame));
+    a.step = 0;
+}
+
+void drawAnimCell(Layer &terrain, const AnimCell &c, int frame)
+{
+    if (isVisible(c.x, c.y)) // Remembered cells keep the map glyph, unseen ones the fog
+        terrain.cells[c.y][c.x] = ANIMATED_TILES[c.kind].frames[frame];
+}
+
+// Moves the next phase on a frame and redraws its cells.
+void stepAnimatedTiles(AnimatedTiles &a, Layer &terrain)
+{
+    int phase = (int)(a.step % ANIM_PHASES);
+    int frame = (int)((a.step / ANIM_PHASES + phase) % ANIM_FRAMES);
+    a.frame[phase] = (uint8_t)frame;
+    for (int i = a.start[phase]; i < a.start[phase + 1]; i++)
+    {
+        drawAnimCell(terrain, a.cells[i], frame);
+    }
+    a.step++;
+}
+
+// Puts the current frames back on terrain rows that were just rebuilt from
+// the map.
+void redrawAnimatedTiles(const AnimatedTiles &a, Layer &terrain, uint64_t rows)
+{
+    for (int phase = 0; phase < ANIM_PHASES; phase++)
+    {
+        if (a.frame[phase] == 0)
+            continue; // Showing the map glyph already
+        for (int i = a.start[phase]; i < a.start[phase + 1]; i++)
+        {
+            if (rows & (1ull << a.cells[i].y))
+                drawAnimCell(terrain, a.cells[i], a.frame[phase]);
+        }
+    }
+}
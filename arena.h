@@ -0,0 +1,85 @@
+#pragma once
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+
+// Per-frame scratch memory.
+// Anything that only lives for one frame (HUD text, layout work) is carved
+// out of a fixed buffer by bumping a pointer, and the whole buffer is freed at
+// once when the frame ends, so the game loop never goes to the heap for it.
+// Running out is not an error: allocations return nullptr, strings are cut
+// short, and `overflows` counts it so the size can be raised.
+const int FRAME_ARENA_BYTES = 64 * 1024;
+
+struct FrameArena
+{
+    alignas(std::max_align_t) unsigned char bytes[FRAME_ARENA_BYTES];
+    size_t used = 0;
+    size_t high_water = 0; // Most ever used in one frame
+    unsigned int overflows = 0;
+};
+
+FrameArena frameArena;
+
+void *arenaAlloc(FrameArena &a, size_t size, size_t align = alignof(std::max_align_t))
+{
+    size_t start = (a.used + align - 1) & ~(align - 1);
+    if (start + size > FRAME_ARENA_BYTES)
+    {
+        a.overflows++;
+        return nullptr;
+    }
+    a.used = start + size;
+    if (a.used > a.high_water)
+        a.high_water = a.used;
+    return a.bytes + start;
+}
+
+// Frees everything allocated this frame.
+void resetArena(FrameArena &a)
+{
+    a.used = 0;
+}
+
+// A string builder whose storage is in the arena. The capacity is fixed when
+// it is made; anything appended past it is dropped.
+struct ArenaText
+{
+    char *data;
+    int size;
+    int capacity;
+};
+
+ArenaText arenaText(FrameArena &a, int capacity)
+{
+    char *p = static_cast<char *>(arenaAlloc(a, capacity, 1));
+    return {p, 0, p ? capacity : 0};
+}
+
+void appendText(ArenaText &t, const char *s, int n)
+{
+    if (n > t.capacity - t.size)
+        n = t.capacity - t.size;
+    memcpy(t.data + t.size, s, n);
+    t.size += n;
+}
+
+void appendText(ArenaText &t, const char *s)
+{
+    appendText(t, s, (int)strlen(s));
+}
+
+void appendNumber(ArenaText &t, long long n)
+{
+    if (!t.data)
+        return;
+    std::to_chars_result r = std::to_chars(t.data + t.size, t.data + t.capacity, n);
+    if (r.ec == std::errc())
+        t.size = (int)(r.ptr - t.data);
+}
+
+void appendSpaces(ArenaText &t, int count)
+{
+    while (count-- > 0 && t.size < t.capacity)
+        t.data[t.size++] = ' ';
+}
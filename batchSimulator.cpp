@@ -0,0 +1,182 @@
+// Plays thousands of headless games on a pool of threads, with a simple
+// scripted player, and reports how the enemies fare for each setting of
+// enemy_move_throttle. Every setting plays the same seeds, so rows compare
+// like for like, and results don't depend on the number of threads.
+//   g++ -std=c++20 -O2 -pthread batchSimulator.cpp -o batchSimulator
+//   batchSimulator [--games <n>] [--threads <n>] [--ticks <n>] [--throttle <from> <to>] [--generate <seed>]
+#include "simulation.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+const int BOT_THINK_TICKS = 4; // The bot presses a key this often, about as fast as key repeat
+
+struct BatchOptions
+{
+    int games = 1000;
+    int threads = 0; // 0 for one per hardware thread
+    unsigned int ticks = 20000; // Games nobody catches end here
+    int throttle_from = 2;
+    int throttle_to = 12;
+    uint32_t map_seed = 0;
+};
+
+struct GameResult
+{
+    unsigned int ticks; // How long the game lasted
+    bool caught;
+    int world;          // Furthest world reached
+    int kills;
+};
+
+// A player that heads east: it jabs an enemy right in front of it, throws
+// the stinger at one lined up further off, and otherwise wanders, mostly
+// eastwards. It has its own generator so the game's random numbers go the
+// same way they would with a person playing.
+int botKey(const GameState &g, uint32_t &rng)
+{
+    if (g.tick % BOT_THINK_TICKS != 0)
+        return 0;
+    if (entityAt(g, g.player_x + g.facing_x, g.player_y + g.facing_y) >= 0)
+        return ' ';
+    if (!findTimer(g.timers, g.stinger_timer))
+    {
+        for (int d = 2; d <= STINGER_RANGE; d++)
+        {
+            if (entityAt(g, g.player_x + g.facing_x * d, g.player_y + g.facing_y * d) >= 0)
+                return 'e';
+        }
+    }
+    uint32_t r = nextRandom(rng) % 10;
+    return r < 5 ? 'd' : r < 7 ? 'w' : r < 9 ? 's' : 'a';
+}
+
+int aliveEnemies(const GameState &g)
+{
+    int alive = 0;
+    for (const NPC &e : g.enemies)
+        alive += e.is_alive ? 1 : 0;
+    return alive;
+}
+
+GameResult playGame(GameState &g, uint32_t seed, int throttle, unsigned int maxTicks)
+{
+    g.enemy_move_throttle = throttle;
+    startGame(g, seed);
+    uint32_t botRng = seed ^ 0xB07B07B0u;
+    seedRandom(botRng, botRng);
+
+    GameResult result = {0, false, 0, 0};
+    while (g.tick < maxTicks && !g.player_caught)
+    {
+        int alive = aliveEnemies(g);
+        unsigned int entered = g.worlds_entered;
+        simulateTick(g, botKey(g, botRng), [](const GameState &) {});
+        if (g.worlds_entered == entered)
+            result.kills += alive - aliveEnemies(g);
+        if (g.current_world > result.world)
+            result.world = g.current_world;
+    }
+    result.ticks = g.tick;
+    result.caught = g.player_caught;
+    return result;
+}
+
+bool parseOptions(int argc, char const *argv[], BatchOptions &o)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--games") == 0 && i + 1 < argc)
+            o.games = atoi(argv[++i]);
+        else if (strcmp(arg, "--threads") == 0 && i + 1 < argc)
+            o.threads = atoi(argv[++i]);
+        else if (strcmp(arg, "--ticks") == 0 && i + 1 < argc)
+            o.ticks = (unsigned int)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(arg, "--throttle") == 0 && i + 2 < argc)
+        {
+            o.throttle_from = atoi(argv[++i]);
+            o.throttle_to = atoi(argv[++i]);
+        }
+        else if (strcmp(arg, "--generate") == 0 && i + 1 < argc)
+            o.map_seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else
+            return false;
+    }
+    return o.games > 0 && o.ticks > 0 && o.throttle_from >= 0 && o.throttle_to >= o.throttle_from;
+}
+
+int main(int argc, char const *argv[])
+{
+    BatchOptions o;
+    if (!parseOptions(argc, argv, o))
+    {
+        fprintf(stderr, "usage: %s [--games <n>] [--threads <n>] [--ticks <n>] [--throttle <from> <to>] [--generate <seed>]\n", argv[0]);
+        return 2;
+    }
+    int threads = o.threads > 0 ? o.threads : (int)std::thread::hardware_concurrency();
+    if (threads < 1)
+        threads = 1;
+
+    // The worlds are the same for every game, so they are built once and
+    // shared read-only.
+    std::vector<LoadedWorld> worlds(WORLD_COUNT);
+    for (int i = 0; i < WORLD_COUNT; i++)
+        loadWorld(i, o.map_seed, worlds[i]);
+
+    int settings = o.throttle_to - o.throttle_from + 1;
+    int jobs = settings * o.games;
+    std::vector<GameResult> results(jobs);
+    std::atomic<int> nextJob{0};
+    auto start = std::chrono::steady_clock::now();
+
+    // Each worker reuses one GameState for all its games.
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++)
+    {
+        pool.emplace_back([&]()
+                          {
+                              std::unique_ptr<GameState> g = std::make_unique<GameState>();
+                              g->worlds = worlds.data();
+                              g->map_seed = o.map_seed;
+                              for (int job = nextJob++; job < jobs; job = nextJob++)
+                              {
+                                  int game = job % o.games;
+                                  int throttle = o.throttle_from + job / o.games;
+                                  results[job] = playGame(*g, (uint32_t)game * 2654435761u + 1, throttle, o.ticks);
+                              } });
+    }
+    for (std::thread &t : pool)
+        t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%d games per setting, up to %u ticks each, map seed %u\n", o.games, o.ticks, o.map_seed);
+    printf("throttle  caught  ticks to catch  furthest world  kills\n");
+    unsigned long long totalTicks = 0;
+    for (int s = 0; s < settings; s++)
+    {
+        int caught = 0;
+        unsigned long long catchTicks = 0, worldSum = 0, killSum = 0;
+        for (int n = 0; n < o.games; n++)
+        {
+            const GameResult &r = results[s * o.games + n];
+            totalTicks += r.ticks;
+            worldSum += r.world + 1;
+            killSum += r.kills;
+            if (r.caught)
+            {
+                caught++;
+                catchTicks += r.ticks;
+            }
+        }
+        printf("%8d  %5.1f%%  %14.0f  %14.2f  %5.2f\n", o.throttle_from + s, 100.0 * caught / o.games,
+               caught ? (double)catchTicks / caught : 0.0, (double)worldSum / o.games, (double)killSum / o.games);
+    }
+    printf("%d games, %llu ticks in %.2f s on %d threads (%.0f ticks/s)\n", jobs, totalTicks, seconds, threads,
+           seconds > 0 ? totalTicks / seconds : 0.0);
+    return 0;
+}
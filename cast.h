@@ -0,0 +1,255 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+// Session recorder in asciicast v2 format (.cast, playable with asciinema).
+// Every write to the console (frames, menus, the title and intro scenes) is
+// also copied, with a timestamp, into a single-producer single-consumer byte
+// ring. A writer thread drains the ring, turns records into JSON lines and
+// writes them, so the game loop only pays for a memcpy and never waits on
+// the disk. If the ring is ever full the write is dropped and the renderer
+// sends its next frame in full, so the recording heals instead of drifting.
+const uint32_t CAST_RING_BYTES = 4u << 20; // Must be a power of two
+const uint32_t CAST_MAX_RECORD_BYTES = 256u << 10;
+const int CAST_WRITER_IDLE_MS = 5;
+
+enum CastEventType : uint8_t
+{
+    CAST_OUTPUT, // Bytes sent to the terminal
+    CAST_RESIZE  // Terminal size changed; payload is "COLSxROWS"
+};
+
+struct CastRecordHeader
+{
+    uint64_t time_ns; // Since the recording started
+    uint32_t size;    // Payload bytes that follow
+    uint8_t type;
+};
+
+struct CastRecorder
+{
+    FILE *file = nullptr;
+    std::thread writer;
+    std::atomic<bool> running{false};
+    std::chrono::steady_clock::time_point started;
+
+    // The ring. head and tail only ever grow; the producer owns head and the
+    // writer owns tail.
+    unsigned char ring[CAST_RING_BYTES];
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+
+    unsigned int dropped = 0;
+    bool missed = false; // A write was dropped since castMissedOutput() last looked
+
+    ~CastRecorder();
+};
+
+CastRecorder castRecorder;
+
+void castRingWrite(CastRecorder &c, uint64_t at, const void *data, uint32_t n)
+{
+    uint32_t offset = (uint32_t)(at & (CAST_RING_BYTES - 1));
+    uint32_t first = CAST_RING_BYTES - offset < n ? CAST_RING_BYTES - offset : n;
+    memcpy(c.ring + offset, data, first);
+    memcpy(c.ring, static_cast<const unsigned char *>(data) + first, n - first);
+}
+
+void castRingRead(const CastRecorder &c, uint64_t at, void *data, uint32_t n)
+{
+    uint32_t offset = (uint32_t)(at & (CAST_RING_BYTES - 1));
+    uint32_t first = CAST_RING_BYTES - offset < n ? CAST_RING_BYTES - offset : n;
+    memcpy(data, c.ring + offset, first);
+    memcpy(static_cast<unsigned char *>(data) + first, c.ring, n - first);
+}
+
+// Producer side. Returns false (and drops the record) if the ring is full.
+bool pushCastRecord(CastRecorder &c, CastEventType type, const char *data, uint32_t size)
+{
+    uint64_t head = c.head.load(std::memory_order_relaxed);
+    uint64_t tail = c.tail.load(std::memory_order_acquire);
+    uint64_t needed = sizeof(CastRecordHeader) + size;
+    if (size > CAST_MAX_RECORD_BYTES || CAST_RING_BYTES - (head - tail) < needed)
+    {
+        c.dropped++;
+        return false;
+    }
+    CastRecordHeader h;
+    memset(&h, 0, sizeof(h));
+    h.time_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - c.started).count();
+    h.size = size;
+    h.type = type;
+    castRingWrite(c, head, &h, sizeof(h));
+    castRingWrite(c, head + sizeof(h), data, size);
+    c.head.store(head + needed, std::memory_order_release);
+    return true;
+}
+
+// Length of the well-formed UTF-8 sequence at data[0], or 0 if it isn't one.
+int utf8SequenceLength(const unsigned char *data, uint32_t size)
+{
+    unsigned char lead = data[0];
+    int length = lead >= 0xC2 && lead <= 0xDF ? 2 : lead >= 0xE0 && lead <= 0xEF ? 3 : lead >= 0xF0 && lead <= 0xF4 ? 4 : 0;
+    if (length == 0 || (uint32_t)length > size)
+        return 0;
+    for (int i = 1; i < length; i++)
+    {
+        if ((data[i] & 0xC0) != 0x80)
+            return 0;
+    }
+    // No overlong forms, surrogates or code points past U+10FFFF.
+    unsigned char second = data[1];
+    if ((lead == 0xE0 && second < 0xA0) || (lead == 0xED && second > 0x9F) || (lead == 0xF0 && second < 0x90) || (lead == 0xF4 && second > 0x8F))
+        return 0;
+    return length;
+}
+
+// Writes `data` as the inside of a JSON string. UTF-8 text goes in as it is;
+// bytes that aren't part of any character become U+FFFD.
+void writeCastString(FILE *f, const unsigned char *data, uint32_t size)
+{
+    static const char hex[] = "0123456789abcdef";
+    char buf[4096];
+    int n = 0;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        if (n > (int)sizeof(buf) - 8)
+        {
+            fwrite(buf, 1, n, f);
+            n = 0;
+        }
+        unsigned char ch = data[i];
+        if (ch == '"' || ch == '\\')
+        {
+            buf[n++] = '\\';
+            buf[n++] = (char)ch;
+        }
+        else if (ch < 0x20 || ch == 0x7F)
+        {
+            // Control bytes (ESC, \r, \n).
+            buf[n++] = '\\';
+            buf[n++] = 'u';
+            buf[n++] = '0';
+            buf[n++] = '0';
+            buf[n++] = hex[ch >> 4];
+            buf[n++] = hex[ch & 15];
+        }
+        else if (ch >= 0x80)
+        {
+            int length = utf8SequenceLength(data + i, size - i);
+            if (length > 0)
+            {
+                memcpy(buf + n, data + i, length);
+                n += length;
+                i += length - 1;
+            }
+            else
+            {
+                memcpy(buf + n, "\\ufffd", 6);
+                n += 6;
+            }
+        }
+        else
+        {
+            buf[n++] = (char)ch;
+        }
+    }
+    fwrite(buf, 1, n, f);
+}
+
+// Writer side: turns every complete record in the ring into a line of the file.
+void drainCastRing(CastRecorder &c, unsigned char *scratch)
+{
+    uint64_t tail = c.tail.load(std::memory_order_relaxed);
+    uint64_t head = c.head.load(std::memory_order_acquire);
+    while (tail != head)
+    {
+        CastRecordHeader h;
+        castRingRead(c, tail, &h, sizeof(h));
+        uint32_t size = h.size;
+        castRingRead(c, tail + sizeof(h), scratch, size);
+        tail += sizeof(h) + h.size;
+        c.tail.store(tail, std::memory_order_release); // The record is copied out; give the space back
+
+        fprintf(c.file, "[%.6f, \"%s\", \"", h.time_ns / 1e9, h.type == CAST_RESIZE ? "r" : "o");
+        writeCastString(c.file, scratch, size);
+        fputs("\"]\n", c.file);
+    }
+}
+
+void runCastWriter(CastRecorder *c)
+{
+    static unsigned char scratch[CAST_MAX_RECORD_BYTES];
+    while (true)
+    {
+        bool stopping = !c->running.load(std::memory_order_acquire);
+        drainCastRing(*c, scratch);
+        if (stopping)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(CAST_WRITER_IDLE_MS));
+    }
+    fflush(c->file);
+}
+
+bool openCastRecorder(CastRecorder &c, const char *path, int cols, int rows)
+{
+    c.file = fopen(path, "wb");
+    if (!c.file)
+        return false;
+    fprintf(c.file, "{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %lld, \"env\": {\"TERM\": \"xterm-256color\"}}\n",
+            cols, rows, (long long)time(nullptr));
+    c.head.store(0);
+    c.tail.store(0);
+    c.started = std::chrono::steady_clock::now();
+    c.running.store(true, std::memory_order_release);
+    c.writer = std::thread(runCastWriter, &c);
+    return true;
+}
+
+void closeCastRecorder(CastRecorder &c)
+{
+    if (!c.file)
+        return;
+    c.running.store(false, std::memory_order_release);
+    if (c.writer.joinable())
+        c.writer.join();
+    fclose(c.file);
+    c.file = nullptr;
+}
+
+CastRecorder::~CastRecorder()
+{
+    closeCastRecorder(*this);
+}
+
+// Called by the console with everything it writes.
+void castOutput(CastRecorder &c, const char *data, int size)
+{
+    if (!c.file || size <= 0)
+        return;
+    if (!pushCastRecord(c, CAST_OUTPUT, data, (uint32_t)size))
+        c.missed = true;
+}
+
+// Whether any output was dropped since the last call. The renderer then
+// sends its next frame in full, so the recording catches up.
+bool castMissedOutput(CastRecorder &c)
+{
+    bool missed = c.missed;
+    c.missed = false;
+    return missed;
+}
+
+void castResize(CastRecorder &c, int cols, int rows)
+{
+    if (!c.file)
+        return;
+    char size[32];
+    int n = snprintf(size, sizeof(size), "%dx%d", cols, rows);
+    pushCastRecord(c, CAST_RESIZE, size, (uint32_t)n);
+}
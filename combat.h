@@ -0,0 +1,167 @@
+#pragma once
+#include "consoleGameEngine.h"
+#include "gamestate.h"
+#include "mechanics.h"
+#include "telemetry.h"
+#include <cstdint>
+#include <cstring>
+
+// Rocky's stinger: a jab at the next cell, or a stinger thrown in a straight
+// line. Thrown stingers live in a fixed pool with a free list and advance on
+// the simulation tick, so they are game state and go into snapshots and
+// replays. The pool (StingerPool, in gamestate.h) is plain data and is copied
+// into snapshots as it is. Hits are resolved through GameState::entity_at,
+// which records the enemy standing on each cell, so a hit test is one lookup
+// however many enemies there are.
+const int STINGER_RANGE = 24;          // Cells a thrown stinger flies before it drops
+const int STINGER_STEP_TICKS = 2;      // Ticks per cell
+const int STINGER_COOLDOWN_TICKS = 40; // Ticks between throws
+const uint8_t NO_ENTITY = 0xFF;
+
+static_assert(MAX_ENEMIES < NO_ENTITY, "Enemy indices must fit in entity_at");
+
+void resetStingers(StingerPool &p)
+{
+    memset(&p, 0, sizeof(p));
+    p.free_head = 0;
+    for (int i = 0; i < MAX_STINGERS - 1; i++)
+        p.next_free[i] = (int16_t)(i + 1);
+    p.next_free[MAX_STINGERS - 1] = -1;
+}
+
+void rebuildEntityGrid(GameState &g)
+{
+    memset(g.entity_at, NO_ENTITY, sizeof(g.entity_at));
+    for (int i = 0; i < MAX_ENEMIES; i++)
+    {
+        if (g.enemies[i].is_alive)
+            g.entity_at[g.enemies[i].y][g.enemies[i].x] = (uint8_t)i;
+    }
+}
+
+int entityAt(const GameState &g, int x, int y)
+{
+    if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT)
+        return -1;
+    return g.entity_at[y][x] == NO_ENTITY ? -1 : g.entity_at[y][x];
+}
+
+void moveEntity(GameState &g, int i, int x, int y)
+{
+    NPC &e = g.enemies[i];
+    if (g.entity_at[e.y][e.x] == i)
+        g.entity_at[e.y][e.x] = NO_ENTITY;
+    e.x = x;
+    e.y = y;
+    g.entity_at[y][x] = (uint8_t)i;
+}
+
+void killEnemy(GameState &g, int i)
+{
+    NPC &e = g.enemies[i];
+    logEvent(telemetry, TEL_DEATH, i, e.x, e.y, 0);
+    e.is_alive = false;
+    if (g.entity_at[e.y][e.x] == i)
+        g.entity_at[e.y][e.x] = NO_ENTITY;
+}
+
+// Kills whatever stands on (x, y). Returns true if something was hit.
+bool strikeCell(GameState &g, int x, int y)
+{
+    int i = entityAt(g, x, y);
+    if (i < 0)
+        return false;
+    killEnemy(g, i);
+    return true;
+}
+
+// Melee: Rocky at (x, y) jabs the neighbouring cell in direction (dx, dy).
+bool handleAttack(GameState &g, int x, int y, int dx, int dy)
+{
+    if (dx == 0 && dy == 0)
+        return false;
+    return strikeCell(g, x + dx, y + dy);
+}
+
+// Returns false when the pool is full.
+bool throwStinger(StingerPool &p, int x, int y, int dx, int dy)
+{
+    if (p.free_head < 0 || (dx == 0 && dy == 0))
+        return false;
+    int i = p.free_head;
+    p.free_head = p.next_free[i];
+    p.stingers[i] = {(int16_t)x, (int16_t)y, (int8_t)dx, (int8_t)dy, (int16_t)STINGER_RANGE, (int16_t)STINGER_STEP_TICKS};
+    p.active[p.active_count++] = (int16_t)i;
+    return true;
+}
+
+// Checks a pool that came from outside, such as a save file: every stinger
+// is either flying (listed once in `active`) or on the free list, and the
+// flying ones are on the map, heading one cell a step with no more than a
+// throw's range and wait left.
+bool isStingerPoolValid(const StingerPool &p)
+{
+    if (p.active_count < 0 || p.active_count > MAX_STINGERS)
+        return false;
+    bool seen[MAX_STINGERS] = {};
+    for (int n = 0; n < p.active_count; n++)
+    {
+        int i = p.active[n];
+        if (i < 0 || i >= MAX_STINGERS || seen[i])
+            return false;
+        const Stinger &s = p.stingers[i];
+        if (s.x < 0 || s.x >= WIDTH || s.y < 0 || s.y >= HEIGHT)
+            return false;
+        if (s.dx < -1 || s.dx > 1 || s.dy < -1 || s.dy > 1 || (s.dx == 0 && s.dy == 0))
+            return false;
+        if (s.range > STINGER_RANGE || s.wait > STINGER_STEP_TICKS)
+            return false;
+        seen[i] = true;
+    }
+    int free = 0;
+    for (int i = p.free_head; i != -1; i = p.next_free[i])
+    {
+        if (i < 0 || i >= MAX_STINGERS || seen[i])
+            return false;
+        seen[i] = true;
+        free++;
+    }
+    return p.active_count + free == MAX_STINGERS;
+}
+
+// One simulation tick of flight. A stinger stops when it hits an enemy,
+// something tall (trees, walls), the map edge, or runs out of range; it
+// flies over water like the bee that threw it.
+void updateStingers(GameState &g)
+{
+    StingerPool &p = g.stingers;
+    for (int n = 0; n < p.active_count;)
+    {
+        Stinger &s = p.stingers[p.active[n]];
+        bool done = strikeCell(g, s.x, s.y); // An enemy walked into it
+        if (!done && --s.wait <= 0)
+        {
+            s.wait = STINGER_STEP_TICKS;
+            int nx = s.x + s.dx, ny = s.y + s.dy;
+            if (--s.range < 0 || nx < 0 || nx >= WIDTH || ny < 0 || ny >= HEIGHT || (g.collision.flags[ny][nx] & TILE_BLOCKS_SIGHT))
+            {
+                done = true;
+            }
+            else
+            {
+                s.x = (int16_t)nx;
+                s.y = (int16_t)ny;
+                done = strikeCell(g, nx, ny);
+            }
+        }
+        if (done)
+        {
+            int i = p.active[n];
+            p.next_free[i] = p.free_head;
+            p.free_head = (int16_t)i;
+            p.active[n] = p.active[--p.active_count]; // Swap-remove
+            continue;
+        }
+        n++;
+    }
+}
@@ -3,6 +3,10 @@
 #include <thread>
 #include <chrono>
 #include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include "cast.h"
 // using namespace std;
 
 #define WIDTH 160
@@ -12,37 +16,419 @@
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
 #include <conio.h>
+#else
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+struct ConsoleSize
+{
+    int cols;
+    int rows;
+};
+
+// Arrow keys come from the terminal as several bytes (ESC [ A on POSIX, a
+// 0xE0 prefix on Windows). Backends decode them into the WASD key for the
+// same direction, so nothing above sees the parts of a sequence; other
+// special keys are dropped.
+const int KEY_ESCAPE = 27;
+const int ESCAPE_SEQUENCE_MS = 25; // A lone Esc is one with nothing after it within this long
+
+int arrowKey(char direction) // 'A'..'D' as in ESC [ A
+{
+    switch (direction)
+    {
+    case 'A':
+        return 'w';
+    case 'B':
+        return 's';
+    case 'C':
+        return 'd';
+    case 'D':
+        return 'a';
+    }
+    return 0;
+}
+
+// ------------------------------- CONSOLE BACKENDS --------------------------------------------
+// Console<Backend> is the one interface the engine talks to the terminal
+// through. A backend is a struct of static functions (initialize, shutdown,
+// write, readKey, size); the template adds what can be built on top of them.
+// All output, from the renderer and from the scenes alike, goes through
+// Console::write, which is also where a session recording (cast.h) taps it.
+// Everything is resolved at compile time, so a call through GameConsole is a
+// direct, inlinable call into the backend.
+//   Win32Console   - Windows console API, ANSI output through VT processing
+//   AnsiConsole    - POSIX terminals: termios raw input, ANSI output
+//   MemoryConsole  - no terminal at all; output is counted and the last
+//                    write kept, input comes from a script. For tests and
+//                    benchmarks (build with ROCKY_CONSOLE_MEMORY).
+// The free functions below (initializeConsole, getLiveInput, ...) forward
+// to GameConsole so existing code doesn't need to know about backends.
+template <class Backend>
+struct Console
+{
+    static void initialize() { Backend::initialize(); }
+    static void shutdown() { Backend::shutdown(); }
+    static int readKey() { return Backend::readKey(); }
+    static ConsoleSize size() { return Backend::size(); }
+
+    static void write(const char *data, int size)
+    {
+        Backend::write(data, size);
+        castOutput(castRecorder, data, size);
+    }
+
+    static void write(const char *text)
+    {
+        write(text, (int)strlen(text));
+    }
+
+    static void clear()
+    {
+        write("\033[2J\033[H", 7);
+    }
+
+    static void goToXY(int x, int y)
+    {
+        char move[32];
+        int n = snprintf(move, sizeof(move), "\033[%d;%dH", y + 1, x + 1);
+        write(move, n);
+    }
+
+    static void drawChar(int x, int y, char c)
+    {
+        char cell[32];
+        int n = snprintf(cell, sizeof(cell), "\033[%d;%dH%c", y + 1, x + 1, c);
+        write(cell, n);
+    }
+};
+
+#if defined(_WIN32) || defined(_WIN64)
+struct Win32Console
+{
+    static void setCursorVisible(bool visible)
+    {
+        CONSOLE_CURSOR_INFO cursorInfo;
+        GetConsoleCursorInfo(GetStdHandle(STD_OUTPUT_HANDLE), &cursorInfo);
+        cursorInfo.bVisible = visible ? TRUE : FALSE;
+        SetConsoleCursorInfo(GetStdHandle(STD_OUTPUT_HANDLE), &cursorInfo);
+    }
+
+    static void initialize()
+    {
+        setCursorVisible(false);
+
+        // Let the console interpret ANSI escape sequences; the frame renderer
+        // moves the cursor with them instead of one API call per jump.
+        DWORD mode = 0;
+        GetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), &mode);
+        SetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+
+    static void shutdown()
+    {
+        setCursorVisible(true);
+    }
+
+    static void write(const char *data, int size)
+    {
+        fwrite(data, 1, size, stdout);
+        fflush(stdout);
+    }
+
+    static int readKey()
+    {
+        if (!_kbhit())
+        {
+            return 0;
+        }
+        int c = _getch();
+        if (c != 0 && c != 0xE0)
+        {
+            return c;
+        }
+        switch (_getch()) // Scan code of a special key
+        {
+        case 72:
+            return arrowKey('A');
+        case 80:
+            return arrowKey('B');
+        case 77:
+            return arrowKey('C');
+        case 75:
+            return arrowKey('D');
+        }
+        return 0;
+    }
+
+    static ConsoleSize size()
+    {
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info))
+        {
+            return {info.srWindow.Right - info.srWindow.Left + 1, info.srWindow.Bottom - info.srWindow.Top + 1};
+        }
+        return {WIDTH, HEIGHT + 1};
+    }
+};
+#else
+struct AnsiConsole
+{
+    inline static termios original; // Restored by shutdown()
+    inline static volatile std::sig_atomic_t raw = 0;
+
+    // Puts the terminal back as it was. Only uses calls that are safe in a
+    // signal handler, so Ctrl-C and kill leave a usable shell behind too.
+    static void restore()
+    {
+        if (!raw)
+            return;
+        raw = 0;
+        if (::write(STDOUT_FILENO, "\033[?25h", 6) < 0)
+        {
+            // Nothing more to do about it
+        }
+        tcsetattr(STDIN_FILENO, TCSANOW, &original);
+    }
+
+    static void onFatalSignal(int sig)
+    {
+        restore();
+        std::signal(sig, SIG_DFL);
+        std::raise(sig);
+    }
+
+    static void initialize()
+    {
+        // Keys arrive one at a time without echo, and reads never wait.
+        // Ctrl-C still interrupts; the handlers restore the terminal first.
+        if (tcgetattr(STDIN_FILENO, &original) == 0)
+        {
+            termios t = original;
+            t.c_lflag &= ~(ICANON | ECHO);
+            t.c_cc[VMIN] = 0;
+            t.c_cc[VTIME] = 0;
+            raw = tcsetattr(STDIN_FILENO, TCSANOW, &t) == 0;
+        }
+        static bool hooked = false;
+        if (!hooked)
+        {
+            hooked = true;
+            std::atexit(restore);
+            for (int sig : {SIGINT, SIGTERM, SIGHUP, SIGQUIT})
+                std::signal(sig, onFatalSignal);
+        }
+        write("\033[?25l", 6); // Hide the cursor
+    }
+
+    static void shutdown()
+    {
+        write("\033[?25h", 6);
+        restore();
+    }
+
+    static void write(const char *data, int size)
+    {
+        fwrite(data, 1, size, stdout);
+        fflush(stdout);
+    }
+
+    // The next input byte if one arrives within `ms`, otherwise -1.
+    static int readByte(int ms)
+    {
+        pollfd in = {STDIN_FILENO, POLLIN, 0};
+        unsigned char c;
+        if (ms > 0 && poll(&in, 1, ms) <= 0)
+            return -1;
+        return ::read(STDIN_FILENO, &c, 1) == 1 ? c : -1;
+    }
+
+    static int readKey()
+    {
+        int c = readByte(0);
+        if (c < 0)
+            return 0;
+        if (c != KEY_ESCAPE)
+            return c;
+
+        // An escape sequence follows its Esc at once; a key press of Esc doesn't.
+        int next = readByte(ESCAPE_SEQUENCE_MS);
+        if (next < 0)
+            return KEY_ESCAPE;
+        if (next != '[' && next != 'O')
+            return 0; // Alt+key
+        int final = readByte(ESCAPE_SEQUENCE_MS);
+        while (final >= 0 && (final < 0x40 || final > 0x7E))
+            final = readByte(ESCAPE_SEQUENCE_MS); // Parameter bytes, e.g. ESC [ 1 ; 5 A
+        return final >= 0 ? arrowKey((char)final) : 0;
+    }
+
+    static ConsoleSize size()
+    {
+        winsize ws;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0)
+        {
+            return {ws.ws_col, ws.ws_row};
+        }
+        return {WIDTH, HEIGHT + 1};
+    }
+};
+#endif
+
+struct MemoryConsole
+{
+    static const int OUTPUT_BYTES = 1 << 20;
+
+    inline static ConsoleSize terminal = {WIDTH, HEIGHT + 1}; // Reported by size(); set it to test resizing
+    inline static const char *keys = "";                      // Scripted input, one key per readKey(); '_' is a read with no key
+    inline static char output[OUTPUT_BYTES];                   // The most recent write
+    inline static int output_size = 0;
+    inline static unsigned long long bytes_written = 0;
+    inline static unsigned long long writes = 0;
+    inline static int quit_step = 0;
+
+    static void initialize() {}
+    static void shutdown() {}
+
+    static void write(const char *data, int size)
+    {
+        output_size = size < OUTPUT_BYTES ? size : OUTPUT_BYTES;
+        memcpy(output, data, output_size);
+        bytes_written += size;
+        writes++;
+    }
+
+    // Once the script runs out, Esc, 'q' and 'y' are pressed in turn. That
+    // quits from the title screen, the game and every menu, so a run always
+    // ends.
+    static int readKey()
+    {
+        if (*keys)
+        {
+            char c = *keys++;
+            return c == '_' ? 0 : (unsigned char)c;
+        }
+        static const char quit[] = {KEY_ESCAPE, 'q', 'y'};
+        return quit[quit_step++ % 3];
+    }
+
+    static ConsoleSize size()
+    {
+        return terminal;
+    }
+};
+
+#if defined(ROCKY_CONSOLE_MEMORY)
+using GameConsole = Console<MemoryConsole>;
+#elif defined(_WIN32) || defined(_WIN64)
+using GameConsole = Console<Win32Console>;
+#else
+using GameConsole = Console<AnsiConsole>;
 #endif
 
 void initializeConsole()
 {
-    CONSOLE_CURSOR_INFO cursorInfo;
-    GetConsoleCursorInfo(GetStdHandle(STD_OUTPUT_HANDLE), &cursorInfo);
-    cursorInfo.bVisible = FALSE;
-    SetConsoleCursorInfo(GetStdHandle(STD_OUTPUT_HANDLE), &cursorInfo);
+    GameConsole::initialize();
 }
 
-void goToXY(int x, int y)
+void shutdownConsole()
+{
+    GameConsole::shutdown();
+}
+
+void clearConsole()
 {
-    COORD c = {
-        (short)x, (short)y};
+    GameConsole::clear();
+}
 
-    SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), c);
+void goToXY(int x, int y)
+{
+    GameConsole::goToXY(x, y);
 }
 
 void drawChar(int x, int y, char c)
 {
-    goToXY(x, y);
-    putc(c, stdout);
-    fflush(stdout);
+    GameConsole::drawChar(x, y, c);
 }
 
+// When getLiveInput() last returned a key, for measuring input latency.
+// readKey() returns 0 when no key is waiting.
+std::chrono::steady_clock::time_point last_key_read_at;
+
 int getLiveInput()
 {
-    if (_kbhit())
+    int key = GameConsole::readKey();
+    if (key > 0)
+        last_key_read_at = std::chrono::steady_clock::now();
+    return key;
+}
+
+// ------------------------------- TERMINAL SIZE -----------------------------------------------
+// POSIX terminals announce size changes with SIGWINCH; the Windows console
+// has no signal for it, so its size is polled a few times a second. Either
+// way a change is only reported once the size has stopped changing for
+// RESIZE_SETTLE_MS, so dragging a window edge causes one repaint, not dozens.
+const int RESIZE_SETTLE_MS = 100;
+const int RESIZE_POLL_MS = 250;
+
+volatile std::sig_atomic_t console_resize_signalled = 0;
+ConsoleSize console_size = {0, 0};         // Last size reported
+ConsoleSize console_pending_size = {0, 0}; // Latest size seen, reported once it settles
+std::chrono::steady_clock::time_point console_size_changed_at;
+std::chrono::steady_clock::time_point console_size_polled_at;
+
+ConsoleSize getConsoleSize()
+{
+    return GameConsole::size();
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+void onConsoleResize(int)
+{
+    console_resize_signalled = 1;
+}
+#endif
+
+// Starts listening for size changes and returns the current size; call once
+// after initializeConsole().
+ConsoleSize watchConsoleSize()
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+    std::signal(SIGWINCH, onConsoleResize);
+#endif
+    console_size = console_pending_size = getConsoleSize();
+    return console_size;
+}
+
+// Returns true, with the new size, once per settled size change.
+bool pollConsoleResize(ConsoleSize &size)
+{
+    auto now = std::chrono::steady_clock::now();
+#if defined(_WIN32) || defined(_WIN64)
+    if (now - console_size_polled_at >= std::chrono::milliseconds(RESIZE_POLL_MS))
     {
-        return _getch();
+        console_size_polled_at = now;
+        console_resize_signalled = 1;
     }
-    return 0;
+#endif
+    if (console_resize_signalled)
+    {
+        console_resize_signalled = 0;
+        ConsoleSize current = getConsoleSize();
+        if (current.cols != console_pending_size.cols || current.rows != console_pending_size.rows)
+        {
+            console_pending_size = current;
+            console_size_changed_at = now;
+        }
+    }
+    bool changed = console_pending_size.cols != console_size.cols || console_pending_size.rows != console_size.rows;
+    if (!changed || now - console_size_changed_at < std::chrono::milliseconds(RESIZE_SETTLE_MS))
+    {
+        return false;
+    }
+    size = console_size = console_pending_size;
+    return true;
 }
-
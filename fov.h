@@ -0,0 +1,200 @@
+#pragma once
+#include "consoleGameEngine.h"
+#include "mechanics.h"
+#include <cstdint>
+#include <cstring>
+
+// Field of view and fog of war.
+// Visibility is computed with recursive shadowcasting over the collision map,
+// which only ever touches the cells that end up visible, so a large radius
+// stays cheap. The result is cached and only recomputed when the player moves
+// or the collision data changes (CollisionMap::version), and a recompute
+// reports which rows gained or lost a visible cell, so only those are redrawn.
+// The terrain shows three states: visible tiles as they are, remembered ones
+// (seen before, out of sight now) with the open ground left blank so only
+// the outline of walls, trees and water stays in memory, and unseen ones
+// shrouded.
+const int FOV_RADIUS = 36;                // In columns; rows count double since console cells are tall
+const char FOG_UNSEEN_GLYPH = ':';        // Drawn over tiles the player has never seen
+const char FOG_REMEMBERED_GROUND = ' ';   // Drawn over remembered tiles that don't block movement
+
+static_assert(HEIGHT <= 64, "Changed rows are reported in a 64-bit mask");
+
+// A cell is visible when its stamp equals fov_stamp, so starting a new
+// computation is a single increment instead of clearing the whole grid.
+uint16_t fov_visible[HEIGHT][WIDTH];
+uint16_t fov_stamp = 0;
+bool fov_seen[HEIGHT][WIDTH]; // Remembered tiles, kept until the map is reset
+uint16_t fov_row_visible[HEIGHT]; // Visible cells in each row, as of the last computation
+uint16_t fov_row_count[HEIGHT];   // While computing: visible cells in each row
+uint16_t fov_row_kept[HEIGHT];    // While computing: how many of them were visible last time
+bool fog_enabled = true;
+
+int fov_origin_x = -1;
+int fov_origin_y = -1;
+unsigned int fov_collision_version = 0;
+bool fov_valid = false;
+
+bool isVisible(int x, int y)
+{
+    return !fog_enabled || fov_visible[y][x] == fov_stamp;
+}
+
+void resetFieldOfView()
+{
+    memset(fov_visible, 0, sizeof(fov_visible));
+    memset(fov_seen, 0, sizeof(fov_seen));
+    memset(fov_row_visible, 0, sizeof(fov_row_visible));
+    fov_stamp = 0;
+    fov_valid = false;
+}
+
+// `previous` is the stamp of the last computation; cells still carrying it
+// were visible then.
+void markVisible(int x, int y, uint16_t previous)
+{
+    uint16_t &v = fov_visible[y][x];
+    if (v == fov_stamp)
+        return; // Octants overlap along their edges
+    fov_row_count[y]++;
+    if (v == previous && previous != 0)
+        fov_row_kept[y]++;
+    v = fov_stamp;
+    fov_seen[y][x] = true;
+}
+
+bool opaqueAt(const CollisionMap &c, int x, int y)
+{
+    if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT)
+        return true;
+    return (c.flags[y][x] & TILE_BLOCKS_SIGHT) != 0;
+}
+
+// Scans one octant row by row, narrowing the [start, end] slope window as
+// blockers are found and recursing past each one.
+// xx, xy, yx, yy map octant coordinates back to map coordinates.
+void castLight(const CollisionMap &c, int cx, int cy, int row, float start, float end, int xx, int xy, int yx, int yy, uint16_t previous)
+{
+    if (start < end)
+        return;
+
+    float next_start = start;
+    for (int j = row; j <= FOV_RADIUS; j++)
+    {
+        bool blocked = false;
+        for (int dx = -j; dx <= 0; dx++)
+        {
+            int dy = -j;
+            int x = cx + dx * xx + dy * xy;
+            int y = cy + dx * yx + dy * yy;
+            float left_slope = (dx - 0.5f) / (dy + 0.5f);
+            float right_slope = (dx + 0.5f) / (dy - 0.5f);
+
+            if (start < right_slope)
+                continue;
+            if (end > left_slope)
+                break;
+
+            int mx = x - cx;
+            int my = (y - cy) * 2;
+            if (mx * mx + my * my <= FOV_RADIUS * FOV_RADIUS && x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT)
+            {
+                markVisible(x, y, previous);
+            }
+
+            if (blocked)
+            {
+                if (opaqueAt(c, x, y))
+                {
+                    next_start = right_slope;
+                    continue;
+                }
+                blocked = false;
+                start = next_start;
+            }
+            else if (opaqueAt(c, x, y) && j < FOV_RADIUS)
+            {
+                blocked = true;
+                castLight(c, cx, cy, j + 1, start, left_slope, xx, xy, yx, yy, previous);
+                next_start = right_slope;
+            }
+        }
+        if (blocked)
+            break;
+    }
+}
+
+// Recomputes visibility if it may have changed. Returns the rows whose fog
+// needs redrawing (bit y for row y): those where a cell came into view or
+// went out of it.
+uint64_t updateFieldOfView(const CollisionMap &c, int px, int py)
+{
+    if (fov_valid && px == fov_origin_x && py == fov_origin_y && fov_collision_version == c.version)
+    {
+        return 0;
+    }
+
+    uint16_t previous = fov_stamp;
+    if (++fov_stamp == 0)
+    {
+        // The stamp wrapped around; old stamps could now match again. Every
+        // cell counts as newly visible this time.
+        memset(fov_visible, 0, sizeof(fov_visible));
+        fov_stamp = 1;
+        previous = 0;
+    }
+    memset(fov_row_count, 0, sizeof(fov_row_count));
+    memset(fov_row_kept, 0, sizeof(fov_row_kept));
+
+    static const int octants[8][4] = {
+        {1, 0, 0, 1}, {0, 1, 1, 0}, {0, -1, 1, 0}, {-1, 0, 0, 1},
+        {-1, 0, 0, -1}, {0, -1, -1, 0}, {0, 1, -1, 0}, {1, 0, 0, -1}};
+
+    markVisible(px, py, previous);
+    for (int o = 0; o < 8; o++)
+    {
+        castLight(c, px, py, 1, 1.0f, 0.0f, octants[o][0], octants[o][1], octants[o][2], octants[o][3], previous);
+    }
+
+    // A row changed if a cell came into view (not all of its cells were
+    // visible before) or went out of view (it kept fewer than it had).
+    uint64_t changed = 0;
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        if (fov_row_kept[y] != fov_row_count[y] || fov_row_kept[y] != fov_row_visible[y])
+            changed |= 1ull << y;
+        fov_row_visible[y] = fov_row_count[y];
+    }
+
+    fov_origin_x = px;
+    fov_origin_y = py;
+    fov_collision_version = c.version;
+    fov_valid = true;
+    return changed;
+}
+
+// How a remembered tile is drawn: what blocks movement keeps its glyph, and
+// open ground is left blank.
+char rememberedGlyph(char tile)
+{
+    return isObstacle(tile) ? tile : FOG_REMEMBERED_GROUND;
+}
+
+// Builds one row of the displayed frame: visible tiles show the map,
+// remembered ones their rememberedGlyph(), everything else is shrouded.
+// Entities are layered on afterwards and only where isVisible() is true.
+void composeFogRow(const char *mapRow, int y, char *out)
+{
+    if (!fog_enabled)
+    {
+        memcpy(out, mapRow, WIDTH);
+        return;
+    }
+    for (int x = 0; x < WIDTH; x++)
+    {
+        if (fov_visible[y][x] == fov_stamp)
+            out[x] = mapRow[x];
+        else
+            out[x] = fov_seen[y][x] ? rememberedGlyph(mapRow[x]) : FOG_UNSEEN_GLYPH;
+    }
+}
@@ -2,29 +2,82 @@
 // ECE 114 - Fall 2025
 // Ahmed Ahmed
 // Universal Libraries
+#include "alloctrack.h"
 #include "consoleGameEngine.h"
 #include "mechanics.h"
+#include "combat.h"
 #include "menues.h"
 #include "scenes.h"
 #include "maps.h"
+#include "snapshots.h"
+#include "replay.h"
+#include "fov.h"
+#include "pathfinding.h"
+#include "mapgen.h"
+#include "levels.h"
+#include "particles.h"
+#include "renderer.h"
+#include "layers.h"
+#include "animtiles.h"
+#include "arena.h"
+#include "hotreload.h"
+#include "scripts.h"
+#include "simulation.h"
+#include "latency.h"
 using namespace std;
 
 // Constant Definitions
-int player_x = WIDTH / 2;
-int player_y = HEIGHT / 2;
-char map[HEIGHT][WIDTH];
+GameState game; // The game being played. Its rules are in simulation.h; everything else here presents it
+char frameBuffer[SCREEN_HEIGHT][WIDTH]; // What drawGame() is about to put on screen
 char player_c = 'V';
 
-int enemy_move_throttle = 8; // Enemy moves only once every 5 game loops (frames)
-int enemy_frame_counter = 0; // Counts frames until next enemy move
+unsigned int session_tick = 0; // Ticks run this session; never goes back, used to timestamp replays
+
+const int REWIND_TICKS = 100; // How far back one press of 'z' goes
+const char *QUICKSAVE_PATH = "quicksave.rky";
+
+GameSnapshot tickSnapshot;  // State at the end of the most recent tick
+ReplayWriter recorder;      // Only open when started with --record
+bool replaying = false;     // Set by --replay; keeps replays off the disk save
+unsigned int shown_worlds_entered = 0; // game.worlds_entered when the current world was last shown
+TimerId banner_timer = 0;   // The world's title card is shown while this is pending
+char world_banner[WIDTH + 1]; // Title card of the current world
+bool stats_overlay = false;   // Input latency over the top of the map; toggled with 'i'
+
+const int BANNER_TICKS = 600;
+
+// Timers for effects. They run once per drawn frame and are cosmetic; the
+// simulation's own wheel is part of the GameState.
+enum EffectTimerKind : uint16_t
+{
+    EFFECT_BANNER,  // One-shot: the title card goes away
+    EFFECT_ANIMATE, // Periodic: animated terrain moves on a step
+};
+
+TimerWheel<256> effectTimers;
 
 // Function declarations
 // Mechanics
-void initializeMap();
+void startLiveGame(uint32_t seed);
+void runGameTick(int key);
+void runFrame(int key, bool draw, bool tick = true);
+void showWorld(bool arrived);
 void initializeGardenMap();
-void updateGame(int key);
+bool handleSessionKey(int key);
 void drawGame();
-void UpdateNPCs();
+void drawHud();
+void drawStatsOverlay();
+int pauseGame(int key);
+void updateEffects();
+
+// Save system
+void loadSnapshot(const GameSnapshot &snap);
+void quickSave();
+void quickLoad();
+void rewindGame();
+
+// Replays
+int runReplay(const char *path, bool headless, const char *castPath);
 
 // -------------------------------- SCENES ------------------------------------------------------
 void introductionCinematic();
@@ -36,39 +89,144 @@ bool titleScreen();
 
 int main(int argc, char const *argv[])
 {
+    // Command line: --record <file> saves the session, --replay <file> re-simulates
+    // one at full speed, and --headless skips rendering during a replay.
+    // --generate <seed> reseeds the procedurally generated worlds, and
+    // --cast <file> saves what is shown on screen as an asciicast.
+    // --telemetry <file> logs gameplay events (read it with telemetryDecoder).
+    // --assets <dir> reloads world maps from <dir> as they are edited.
+    // --no-scroll redraws panned views instead of scrolling the terminal.
+    // A ROCKY_CONSOLE_MEMORY build takes --keys <script>, the keys to press.
+    const char *recordPath = nullptr;
+    const char *replayPath = nullptr;
+    const char *castPath = nullptr;
+    const char *assetsPath = nullptr;
+    bool headless = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (arg == "--headless")
+            headless = true;
+        else if (arg == "--generate" && i + 1 < argc)
+            game.map_seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--cast" && i + 1 < argc)
+            castPath = argv[++i];
+        else if (arg == "--telemetry" && i + 1 < argc)
+            openTelemetry(telemetry, argv[++i]);
+        else if (arg == "--assets" && i + 1 < argc)
+            assetsPath = argv[++i];
+        else if (arg == "--no-scroll")
+            renderer.caps.has_scroll = false;
+#if defined(ROCKY_CONSOLE_MEMORY)
+        else if (arg == "--keys" && i + 1 < argc)
+            MemoryConsole::keys = argv[++i];
+#endif
+    }
+
+    if (assetsPath)
+    {
+        // Edited maps aren't part of a recording, so it couldn't be replayed.
+        if (recordPath || replayPath)
+        {
+            fprintf(stderr, "--assets can't be used with --record or --replay\n");
+            return 2;
+        }
+        if (!openAssetWatcher(assetWatcher, assetsPath))
+        {
+            fprintf(stderr, "Could not watch %s\n", assetsPath);
+            return 2;
+        }
+    }
+
+    if (replayPath)
+    {
+        return runReplay(replayPath, headless, castPath);
+    }
+
     initializeConsole(); // Set up console to eliminate flicker
+    ConsoleSize consoleSize = watchConsoleSize();
+    if (castPath)
+    {
+        openCastRecorder(castRecorder, castPath, consoleSize.cols, consoleSize.rows);
+    }
+    resizeRenderer(renderer, consoleSize.cols, consoleSize.rows);
     bool titleOption = titleScreen();
 
     if (titleOption)
     {
         introductionCinematic();
-        initializeMap(); // Set up the starting point of the map
-        InitializeNPCs();
+        uint32_t seed = (uint32_t)chrono::steady_clock::now().time_since_epoch().count();
+        startLiveGame(seed); // Set up the starting point of the map
+        if (recordPath)
+        {
+            openReplayWriter(recorder, recordPath, seed, game.map_seed);
+        }
+        initializeMenus();
+        clearConsole();
+        invalidateScreen(renderer);
 
         // Game loop that runs as long as the character continues to play
-        while (true)
+        for (int frame = 0;; frame++)
         {
+            auto frameStart = chrono::steady_clock::now();
+            int userInput;
+            {
+                AllocStageScope stage(ALLOC_STAGE_INPUT);
+                userInput = getLiveInput();
+                if (userInput < 0 || userInput >= KEY_SELECT_WORLD)
+                {
+                    userInput = 0; // Codes from KEY_SELECT_WORLD up only come from the menu
+                }
+                if (userInput == 'p' || userInput == 'q' || userInput == MENU_KEY_BACK)
+                {
+                    // Menus aren't part of the simulation; only what they choose is recorded.
+                    userInput = pauseGame(userInput);
+                    if (userInput < 0)
+                    {
+                        break;
+                    }
+                    frameStart = chrono::steady_clock::now(); // Time in the menu isn't frame time
+                }
+                else if (userInput != 0)
+                {
+                    beginInputTrace(inputLatency, last_key_read_at); // Menu choices aren't traced
+                }
+                if (userInput != 0)
+                {
+                    recordKey(recorder, session_tick, userInput);
+                }
+            }
 
-            int userInput = getLiveInput();
-
-            if (userInput != 0 && userInput != -1)
+            if (pollAssetWatcher(assetWatcher, game))
             {
-                updateGame(userInput);
+                buildAnimatedTiles(animatedTiles, game.map);
             }
-            if (enemy_frame_counter >= enemy_move_throttle)
-            { // <--- CHECK IF COUNTER MET THROTTLE
-                UpdateNPCs();
-                enemy_frame_counter = 0; // Reset the counter after movement
+            runFrame(userInput, true);
+            auto frameTime = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - frameStart).count();
+            if (frameTime > FRAME_BUDGET_US)
+            {
+                logEvent(telemetry, TEL_FRAME_OVERRUN, 0, 0, 0, (int)frameTime);
             }
-            else
+            if (frame == ALLOC_WARMUP_FRAMES)
             {
-                enemy_frame_counter++; // Increment the counter every loop iteration
+                armAllocGuard(true);
             }
-            drawGame();
             this_thread::sleep_for(chrono::milliseconds(5));
         }
     }
-    system("cls");
+    closeReplayWriter(recorder, session_tick);
+    closeCastRecorder(castRecorder);
+    closeTelemetry(telemetry);
+    closeAssetWatcher(assetWatcher);
+    clearConsole();
+    shutdownConsole();
+    printAllocReport(stdout);
+    printLatencyReport(inputLatency, stdout);
+    printTelemetryReport(telemetry, stdout);
     return 0;
 }
 
@@ -76,131 +234,532 @@ int main(int argc, char const *argv[])
 
 // Function definitions
 
+void startLiveGame(uint32_t seed)
+{
+    resetTimers(effectTimers);
+    banner_timer = 0;
+    scheduleTimer(effectTimers, ANIM_STEP_FRAMES, EFFECT_ANIMATE, 0, ANIM_STEP_FRAMES);
+    game.streamer = &levelStreamer;
+    startGame(game, seed);
+    showWorld(false);
+    session_tick = 0;
+    hasQuickSave = false;
+    clearSnapshotRing(rewindHistory);
+}
 
-
-void initializeMap()
+// Everything after input for one frame: the tick (unless the caller already
+// ran it), effects and drawing, each attributed to its stage for allocation
+// tracking.
+void runFrame(int key, bool draw, bool tick)
 {
-    system("cls");
-    for (int y = 0; y < HEIGHT; y++)
+    if (tick)
+    {
+        AllocStageScope stage(ALLOC_STAGE_SIMULATION);
+        runGameTick(key);
+        markInputTrace(inputLatency, LAT_UPDATE);
+    }
+    if (draw)
     {
-
-        for (int x = 0; x < WIDTH; ++x)
         {
-            map[y][x] = GARDEN_MAP_DATA[y][x];
+            AllocStageScope stage(ALLOC_STAGE_EFFECTS);
+            updateEffects();
         }
+        AllocStageScope stage(ALLOC_STAGE_RENDER);
+        drawGame();
+    }
+    resetArena(frameArena);
+    endAllocFrame();
+}
+
+// One fixed step of the live game. Everything that changes game state goes
+// through here so live play and replays advance identically: the session's
+// own keys, then the simulation, whose end state is saved for rewinding and
+// hashed for replays.
+void runGameTick(int key)
+{
+    if (handleSessionKey(key))
+    {
+        key = 0;
+    }
+    simulateTick(game, key, [](const GameState &g)
+                 {
+                     captureSnapshot(g, tickSnapshot);
+                     pushSnapshot(rewindHistory, tickSnapshot);
+                     if (session_tick % REPLAY_HASH_INTERVAL == 0)
+                         recordHash(recorder, session_tick, hashSnapshot(tickSnapshot)); });
+    session_tick++;
+    if (game.worlds_entered != shown_worlds_entered)
+    {
+        showWorld(true);
     }
 }
 
+// Starts the presentation of the world the game is in over: fog, terrain,
+// title card and particles. `arrived` is false for the first world of a game.
+void showWorld(bool arrived)
+{
+    shown_worlds_entered = game.worlds_entered;
+    resetFieldOfView();
+    markTerrainDirty();
+    buildAnimatedTiles(animatedTiles, game.map);
+    formatWorldBanner(game.current_world, world_banner, sizeof(world_banner));
+    cancelTimer(effectTimers, banner_timer);
+    banner_timer = scheduleTimer(effectTimers, BANNER_TICKS, EFFECT_BANNER);
+    resetParticles(particles);
+    if (arrived)
+    {
+        emitBurst(particles, (float)game.player_x, (float)game.player_y, 60, '*');
+    }
+}
 
 void drawGame()
 {
-    goToXY(0, 0);
-    for (int y = 0; y < HEIGHT; y++)
+    // Terrain only changes when the map or what the player can see does, so
+    // only the rows that changed are rebuilt; entities and UI are redrawn
+    // every frame into their own layers and blended over it.
+    markTerrainDirty(updateFieldOfView(game.collision, game.player_x, game.player_y));
+    if (terrain_dirty_rows)
+    {
+        for (int y = 0; y < HEIGHT; y++)
+        {
+            if (terrain_dirty_rows & (1ull << y))
+                composeFogRow(game.map[y], y, terrainLayer.cells[y]);
+        }
+        memset(terrainLayer.cells[HEIGHT], ' ', WIDTH);
+        redrawAnimatedTiles(animatedTiles, terrainLayer, terrain_dirty_rows);
+        terrain_dirty_rows = 0;
+    }
+
+    clearLayer(entityLayer);
+    const WorldInfo &world = WORLDS[game.current_world];
+    if (world.floret_x >= 0 && isVisible(world.floret_x, world.floret_y))
+    {
+        layerPut(entityLayer, world.floret_x, world.floret_y, FLORET_GLYPH);
+    }
+    // Particles only show on blank ground, so they never hide terrain or characters.
+    drawParticles(particles, [](int x, int y, char glyph)
+                  {
+                      if (terrainLayer.cells[y][x] == ' ' && !entityLayer.cells[y][x] && isVisible(x, y))
+                          layerPut(entityLayer, x, y, glyph); });
+
+    const StingerPool &stingers = game.stingers;
+    for (int n = 0; n < stingers.active_count; n++)
     {
-        // cout.write is faster than repeated << operators for raw char arrays.
-        cout.write(map[y], WIDTH);
-        if (y < HEIGHT - 1)
+        const Stinger &st = stingers.stingers[stingers.active[n]];
+        if (isVisible(st.x, st.y))
         {
-            cout << '\n'; // Print a newline after each row, except the last.
+            layerPut(entityLayer, st.x, st.y, st.dx != 0 ? '-' : '!');
         }
     }
-    cout.flush();
 
-    for (int i = 0; i < MAX_ENEMIES; ++i)
+    for (const NPC &e : game.enemies)
     {
-        if (enemies[i].is_alive)
+        if (e.is_alive && isVisible(e.x, e.y))
         {
-            drawChar(enemies[i].x, enemies[i].y, enemies[i].character);
+            layerPut(entityLayer, e.x, e.y, e.character);
         }
     }
+    layerPut(entityLayer, game.player_x, game.player_y, player_c);
+
+    // Status line under the map, and overlays.
+    clearLayer(uiLayer);
+    if (findTimer(effectTimers, banner_timer))
+    {
+        layerText(uiLayer, 0, HEIGHT, world_banner, (int)strlen(world_banner));
+    }
+    drawHud();
+    if (stats_overlay)
+    {
+        drawStatsOverlay();
+    }
+    if (game.player_caught)
+    {
+        const char gameOver[] = "!!! GAME OVER !!!";
+        layerText(uiLayer, WIDTH / 2 - 5, HEIGHT / 2, gameOver, sizeof(gameOver) - 1);
+    }
 
-    drawChar(player_x, player_y, player_c);
-    goToXY(0, HEIGHT + 1);
-    cout.flush();
+    composeLayers(frameBuffer);
+    markInputTrace(inputLatency, LAT_COMPOSE);
+
+    // Only the cells that changed since the last frame are sent, unless the
+    // terminal was resized. When the clipped view moves with the player, the
+    // terminal is scrolled and only the uncovered edge is sent.
+    handleConsoleResize(renderer);
+    followViewport(renderer, game.player_x, game.player_y);
+    presentFrame(renderer, frameBuffer);
+    markInputTrace(inputLatency, LAT_FLUSH);
 }
 
-void updateGame(int key)
+// Right-hand side of the status line: world, enemies left and the stinger.
+// Built in the frame arena so drawing the HUD never allocates.
+void drawHud()
 {
-    int next_x = player_x;
-    int next_y = player_y;
+    int alive = 0;
+    for (const NPC &e : game.enemies)
+    {
+        alive += e.is_alive ? 1 : 0;
+    }
 
-    switch (key)
+    ArenaText hud = arenaText(frameArena, WIDTH);
+    appendText(hud, WORLDS[game.current_world].name);
+    appendText(hud, " ");
+    appendNumber(hud, game.current_world + 1);
+    appendText(hud, "/");
+    appendNumber(hud, WORLD_COUNT);
+    appendSpaces(hud, 3);
+    appendText(hud, "Enemies ");
+    appendNumber(hud, alive);
+    appendSpaces(hud, 3);
+    if (uint32_t cooldown = timerRemaining(game.timers, game.stinger_timer))
+    {
+        appendText(hud, "Stinger ");
+        appendNumber(hud, cooldown);
+    }
+    else
+    {
+        appendText(hud, "Stinger ready");
+    }
+    appendSpaces(hud, 1);
+    if (hud.size > 0)
     {
-    case 'w':
-        next_y = player_y - 1;
-        break;
-    case 's':
-        next_y = player_y + 1;
-        break;
-    case 'a':
-        next_x = player_x - 1;
-        break;
-    case 'd':
-        next_x = player_x + 1;
-        break;
+        layerText(uiLayer, WIDTH - hud.size, HEIGHT, hud.data, hud.size);
     }
+}
 
-    if (next_x >= 0 && next_x < WIDTH && next_y >= 0 && next_y < HEIGHT)
+// Input latency percentiles in the top left corner of the map, one line per
+// stage, in microseconds from the key being read.
+void drawStatsOverlay()
+{
+    const int percents[] = {50, 95, 99};
+    const char header[] = " input us     p50    p95    p99 ";
+    const int width = sizeof(header) - 1;
+    layerText(uiLayer, 0, 0, header, width);
+    for (int s = 0; s < LAT_STAGES; s++)
     {
-        char nextTile = map[next_y][next_x];
-        if (!isObstacle(nextTile))
+        ArenaText line = arenaText(frameArena, width);
+        appendSpaces(line, 1);
+        appendText(line, LATENCY_STAGE_NAMES[s]);
+        for (int i = 0; i < 3; i++)
         {
-            drawChar(player_x, player_y, map[player_y][player_x]);
-            player_x = next_x;
-            player_y = next_y;
+            ArenaText number = arenaText(frameArena, 12);
+            appendNumber(number, latencyPercentile(inputLatency.stages[s], percents[i]));
+            appendSpaces(line, 17 + 7 * i - number.size - line.size); // Right-aligned under the header
+            appendText(line, number.data, number.size);
+        }
+        appendSpaces(line, width - line.size);
+        if (line.size > 0)
+        {
+            layerText(uiLayer, 0, 1 + s, line.data, line.size);
         }
     }
 }
 
-void UpdateNPCs()
+// Advances cosmetic effects by the real time since the last frame. This is
+// not part of the simulation, so it isn't recorded and replays may skip it.
+void updateEffects()
 {
-    for (int i = 0; i < MAX_ENEMIES; ++i)
+    static auto last = chrono::steady_clock::now();
+    auto now = chrono::steady_clock::now();
+    float dt = chrono::duration<float>(now - last).count();
+    last = now;
+    if (dt > 0.1f)
+    {
+        dt = 0.1f; // Don't let a long pause fling particles across the map
+    }
+
+    const WorldInfo &world = WORLDS[game.current_world];
+    if (world.floret_x >= 0)
     {
-        if (!enemies[i].is_alive)
-            continue;
+        emitFloretEffects(particles, (float)world.floret_x, (float)world.floret_y, FLORET_PARTICLES_PER_FRAME);
+    }
+    updateParticles(particles, dt);
+    advanceTimers(effectTimers, [](const Timer &t)
+                  {
+                      // The banner only looks at whether its timer is still pending.
+                      if (t.kind == EFFECT_ANIMATE)
+                          stepAnimatedTiles(animatedTiles, terrainLayer); });
+}
 
-        int next_x = enemies[i].x;
-        int next_y = enemies[i].y;
+// Keys that are about the session rather than the game: saving, loading,
+// rewinding, the fog and the stats overlay. Returns false for anything else.
+bool handleSessionKey(int key)
+{
+    switch (key)
+    {
+    case 'k':
+        quickSave();
+        return true;
+    case 'l':
+        quickLoad();
+        return true;
+    case 'z':
+        rewindGame();
+        return true;
+    case 'f':
+        fog_enabled = !fog_enabled;
+        markTerrainDirty();
+        return true;
+    case 'i':
+        stats_overlay = !stats_overlay;
+        return true;
+    }
+    return false;
+}
 
-        // Simple A.I.: Move one step closer to the player on the x-axis or y-axis.
-        if (abs(player_x - enemies[i].x) > abs(player_y - enemies[i].y))
+// ------------------------------- MENUS -------------------------------------------------------
+// Opens the in-game menus over the frozen frame; `key` is what opened them
+// ('q' goes straight to the quit prompt). Returns the key to feed the
+// simulation (0 for none), or -1 to quit.
+int pauseGame(int key)
+{
+    int result = 0;
+    int choice = key == 'q' ? 'q' : 0;
+    while (true)
+    {
+        if (choice == 0)
+        {
+            choice = runMenu(pauseMenu, frameBuffer);
+        }
+        if (choice == 'p' || choice == MENU_KEY_BACK)
+        {
+            break;
+        }
+        if (choice == 'l')
+        {
+            int world = runMenu(levelMenu, frameBuffer);
+            if (world >= '1' && world < '1' + WORLD_COUNT)
+            {
+                result = KEY_SELECT_WORLD + (world - '1');
+                break;
+            }
+        }
+        if (choice == 'q')
         {
-            // Move horizontally
-            next_x += (player_x > enemies[i].x) ? 1 : -1;
+            if (runMenu(quitMenu, frameBuffer) == 'y')
+            {
+                return -1;
+            }
+            if (key == 'q')
+            {
+                break; // Opened straight from the game, so go straight back
+            }
         }
-        else
+        choice = 0;
+    }
+    presentFrame(renderer, frameBuffer); // Take the menu down
+    return result;
+}
+
+// ------------------------------- SAVE SYSTEM -------------------------------------------------
+// Restores the live game and brings what is on screen in line with it.
+void loadSnapshot(const GameSnapshot &snap)
+{
+    int world = game.current_world;
+    if (restoreSnapshot(game, snap))
+    {
+        markTerrainDirty();
+        buildAnimatedTiles(animatedTiles, game.map);
+    }
+    if (game.current_world != world)
+    {
+        resetFieldOfView();
+    }
+}
+
+void quickSave()
+{
+    captureSnapshot(game, quickSaveSlot);
+    hasQuickSave = true;
+    if (!replaying)
+    {
+        saveSnapshotToFile(quickSaveSlot, QUICKSAVE_PATH);
+    }
+}
+
+void quickLoad()
+{
+    if (!hasQuickSave && !replaying && !recorder.file)
+    {
+        // Fall back to the save left behind by a previous session. Recorded
+        // sessions skip this, a replay could not reproduce it.
+        hasQuickSave = loadSnapshotFromFile(quickSaveSlot, QUICKSAVE_PATH);
+    }
+    if (hasQuickSave)
+    {
+        loadSnapshot(quickSaveSlot);
+    }
+}
+
+void rewindGame()
+{
+    if (rewindSnapshots(rewindHistory, REWIND_TICKS) > 0)
+    {
+        loadSnapshot(rewindHistory.current);
+    }
+}
+
+// ------------------------------- REPLAYS -----------------------------------------------------
+// Re-simulates a recorded session as fast as possible and checks the state
+// hash wherever the recording stored one. Returns non-zero if the replay
+// diverged so it can be used as a regression check.
+int runReplay(const char *path, bool headless, const char *castPath)
+{
+    ReplayReader reader;
+    if (!openReplayReader(reader, path))
+    {
+        cout << "Could not open replay " << path << "\n";
+        return 2;
+    }
+
+    replaying = true;
+    game.map_seed = reader.map_seed;
+    if (!headless)
+    {
+        initializeConsole();
+        ConsoleSize consoleSize = watchConsoleSize();
+        if (castPath)
         {
-            // Move vertically
-            next_y += (player_y > enemies[i].y) ? 1 : -1;
+            openCastRecorder(castRecorder, castPath, consoleSize.cols, consoleSize.rows);
         }
+        resizeRenderer(renderer, consoleSize.cols, consoleSize.rows);
+        clearConsole();
+        invalidateScreen(renderer);
+    }
+    startLiveGame(reader.seed);
+
+    ReplayRecord rec;
+    bool more = readReplayRecord(reader, rec);
+    unsigned int checked = 0;
+    unsigned int mismatches = 0;
+    long long firstMismatch = -1;
+    auto start = chrono::steady_clock::now();
 
-        // 1. Check for Map Boundaries/Obstacles (using your existing IsObstacle)
-        if (next_x >= 0 && next_x < WIDTH && next_y >= 0 && next_y < HEIGHT && !isObstacle(map[next_y][next_x]))
+    while (more || session_tick <= rec.tick)
+    {
+        unsigned int tick = session_tick;
+        int key = 0;
+        if (more && rec.type == REC_KEY && rec.tick == tick)
         {
+            key = rec.key;
+            more = readReplayRecord(reader, rec);
+        }
 
-            // Clear the old enemy position on the screen/map array
-            drawChar(enemies[i].x, enemies[i].y, map[enemies[i].y][enemies[i].x]);
+        {
+            AllocStageScope stage(ALLOC_STAGE_SIMULATION);
+            runGameTick(key);
+        }
 
-            // Move the enemy
-            enemies[i].x = next_x;
-            enemies[i].y = next_y;
+        while (more && rec.type == REC_HASH && rec.tick == tick)
+        {
+            checked++;
+            if (hashSnapshot(tickSnapshot) != rec.hash)
+            {
+                mismatches++;
+                if (firstMismatch < 0)
+                    firstMismatch = tick;
+            }
+            more = readReplayRecord(reader, rec);
         }
 
-        // 2. Check for Threat (Collision with Player)
-        if (enemies[i].x == player_x && enemies[i].y == player_y)
+        runFrame(0, !headless, false);
+        if (session_tick == ALLOC_WARMUP_FRAMES)
         {
-            // GAME OVER logic goes here!
-            goToXY(WIDTH / 2 - 5, HEIGHT / 2);
-            cout << "!!! GAME OVER !!!";
-            // Implement exit or reset
+            armAllocGuard(true);
         }
     }
+    armAllocGuard(false);
+
+    auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    closeReplayReader(reader);
+    closeCastRecorder(castRecorder);
+    closeTelemetry(telemetry);
+
+    if (!headless)
+    {
+        goToXY(0, HEIGHT + 2);
+        shutdownConsole();
+    }
+    cout << "Replayed " << session_tick << " ticks in " << elapsed / 1000.0 << " ms ("
+         << (elapsed > 0 ? session_tick * 1000000.0 / elapsed : 0.0) << " ticks/s)\n";
+    cout << "State hashes checked: " << checked << ", mismatches: " << mismatches;
+    if (firstMismatch >= 0)
+    {
+        cout << " (first at tick " << firstMismatch << ")";
+    }
+    cout << "\n";
+    printAllocReport(stdout);
+    printTelemetryReport(telemetry, stdout);
+    return mismatches == 0 ? 0 : 1;
 }
 
 // ------------------------------- SCENES ------------------------------------------------------
+// The intro is a few scripts running side by side: the caption typed out
+// under the picture, Rocky flying along beneath it, and one that waits for
+// any key to skip the rest. Skipping shows the whole caption at once.
+const int INTRO_TICK_MS = 10;
+const int INTRO_LETTER_MS = 30;
+const int INTRO_HOLD_MS = 1000; // After the caption is done
+
+ScriptScheduler introScripts;
+bool intro_skipped = false;
+
+// `typed` counts the letters shown so far.
+Script typeCaption(ScriptScheduler &s, int x, int y, const char *text, int &typed)
+{
+    for (; text[typed] != '\0'; typed++)
+    {
+        drawChar(x + typed, y, text[typed]);
+        co_await wait(s, INTRO_LETTER_MS);
+    }
+    co_await wait(s, INTRO_HOLD_MS);
+}
+
+Script flyAcross(ScriptScheduler &s, ScriptActor &rocky, int toX)
+{
+    co_await move_to(s, rocky, toX, rocky.y);
+    co_await wait(s, INTRO_HOLD_MS / 2);
+}
+
+Script skipOnKey(ScriptScheduler &s)
+{
+    co_await keypress(s);
+    intro_skipped = true;
+}
+
 void introductionCinematic()
 {
-    system("cls");
-    scene1.play();
-    this_thread::sleep_for(chrono::seconds(1));
+    resetScriptScheduler(introScripts, INTRO_TICK_MS);
+    intro_skipped = false;
+    scene1.showFrame();
+
+    int captionRow = scene1.frameRows() + 1;
+    ScriptActor rocky;
+    rocky.x = 0;
+    rocky.y = captionRow + 2;
+    rocky.step_ms = 25;
+    int typed = 0;
+    startScript(introScripts, typeCaption(introScripts, 0, captionRow, scene1.caption(), typed));
+    startScript(introScripts, flyAcross(introScripts, rocky, 79));
+    startScript(introScripts, skipOnKey(introScripts));
+
+    int drawnX = -1, drawnY = -1;
+    while (!intro_skipped && introScripts.running > 1) // The skip script never ends by itself
+    {
+        runScripts(introScripts, getLiveInput());
+        if (rocky.x != drawnX || rocky.y != drawnY)
+        {
+            if (drawnX >= 0)
+                drawChar(drawnX, drawnY, ' ');
+            drawChar(rocky.x, rocky.y, player_c);
+            drawnX = rocky.x;
+            drawnY = rocky.y;
+        }
+        this_thread::sleep_for(chrono::milliseconds(INTRO_TICK_MS));
+    }
+    stopScripts(introScripts);
+    if (intro_skipped && scene1.caption()[typed] != '\0')
+    {
+        goToXY(typed, captionRow);
+        GameConsole::write(scene1.caption() + typed);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+#include "consoleGameEngine.h"
+#include "mechanics.h"
+#include "ailod.h"
+#include "levels.h"
+#include "pathfinding.h"
+#include "timers.h"
+#include <cstdint>
+
+// One game: everything the simulation reads and writes. The live game is a
+// GameState, and so is every game of a batch run (batchSimulator.cpp).
+// Simulation code takes the state it works on as a parameter and touches no
+// globals, so any number of games can run side by side, one per thread.
+// Presentation (fog of war, particles, layers, the HUD) only ever reads the
+// live game's state.
+const int MAX_STINGERS = 32;
+const int GAME_TIMERS = 32; // Capacity of the simulation's timer wheel
+
+struct Stinger
+{
+    int16_t x;
+    int16_t y;
+    int8_t dx;
+    int8_t dy;
+    int16_t range; // Cells left to fly
+    int16_t wait;  // Ticks until the next cell
+};
+
+struct StingerPool
+{
+    Stinger stingers[MAX_STINGERS];
+    int16_t next_free[MAX_STINGERS];
+    int16_t free_head;
+    int16_t active_count;
+    int16_t active[MAX_STINGERS];
+};
+
+struct GameState
+{
+    // What a snapshot saves.
+    unsigned int tick = 0; // Simulation time; goes back when rewinding or loading
+    int current_world = 0; // Index into WORLDS
+    char map[HEIGHT][WIDTH];
+    int player_x = WIDTH / 2;
+    int player_y = HEIGHT / 2;
+    int facing_x = 1; // Last direction Rocky moved in; attacks go this way
+    int facing_y = 0;
+    int enemy_move_throttle = 8; // Enemies move once every enemy_move_throttle + 1 ticks
+    NPC enemies[MAX_ENEMIES];
+    StingerPool stingers;
+    TimerId stinger_timer = 0; // Pending while the stinger cools down
+    TimerWheel<GAME_TIMERS> timers;
+    AiLodState ai_lod;
+
+    // Derived from the above; rebuilt when a snapshot is restored.
+    CollisionMap collision;
+    uint8_t entity_at[HEIGHT][WIDTH]; // Index of the enemy on each cell, or NO_ENTITY
+    Pathfinder paths;
+
+    // Not saved.
+    bool player_caught = false; // An enemy reached the player on the last enemy move
+    uint32_t rng = 0x9E3779B9;
+    uint32_t map_seed = 0;        // Seed for the generated worlds
+    unsigned int worlds_entered = 0; // Goes up on every world change, so presentation can follow
+
+    // Where worlds come from: preloaded once for the whole run (batch games),
+    // or else streamed in the background (the live game).
+    const LoadedWorld *worlds = nullptr;
+    LevelStreamer *streamer = nullptr;
+};
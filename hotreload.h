@@ -0,0 +1,233 @@
+#pragma once
+#include "alloctrack.h"
+#include "consoleGameEngine.h"
+#include "gamestate.h"
+#include "layers.h"
+#include "levels.h"
+#include "mechanics.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#ifndef S_ISDIR
+#define S_ISDIR(m) (((m) & S_IFMT) == S_IFDIR) // The Windows CRT has the mask but not the macro
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Hot reload of map art for working on worlds without restarting
+// (--assets <dir>). The map of the world being played is read from
+// <dir>/<name>.map, e.g. garden.map or river_campus.map, one map row per
+// line. When that file is saved it is parsed again and compared with the
+// live map row by row: only rows that differ are copied, their collision
+// flags are updated tile by tile (which also invalidates the field of view
+// and path caches), and they are marked dirty so the terrain layer redraws
+// just those rows. The directory is watched with inotify on Linux, so an
+// edit shows up on the next frame; elsewhere the file's modification time
+// is polled. Reloads change the map outside the simulation, so they can't
+// be recorded and are for development only.
+const int ASSET_POLL_MS = 250; // Polling interval where inotify isn't available
+const int ASSET_FILE_BYTES = (WIDTH + 2) * HEIGHT * 2; // Longer files are cut off
+const int ASSET_NAME_MAX = 64;
+const int ASSET_PATH_MAX = 512;
+
+struct AssetWatcher
+{
+    bool active = false;
+    char dir[ASSET_PATH_MAX];
+    int world = -1; // World whose map is being watched
+    char name[ASSET_NAME_MAX];
+    char path[ASSET_PATH_MAX + ASSET_NAME_MAX];
+    bool pending = false; // Reload on the next poll whatever the watcher says
+
+    int inotify_fd = -1;
+    time_t mtime = 0;
+    std::chrono::steady_clock::time_point next_poll;
+
+    char file[ASSET_FILE_BYTES];
+    char rows[HEIGHT][WIDTH];
+    unsigned int reloads = 0;
+
+    ~AssetWatcher();
+};
+
+AssetWatcher assetWatcher;
+
+// "RIVER CAMPUS" -> "river_campus.map"
+void worldAssetName(int world, char *out, int size)
+{
+    const char *name = WORLDS[world].name;
+    int n = 0;
+    for (; *name && n < size - 5; name++)
+    {
+        char c = *name;
+        out[n++] = c == ' ' ? '_' : (c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c);
+    }
+    memcpy(out + n, ".map", 5);
+}
+
+bool openAssetWatcher(AssetWatcher &w, const char *dir)
+{
+    struct stat st;
+    if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode))
+        return false;
+    snprintf(w.dir, sizeof(w.dir), "%s", dir);
+#ifdef __linux__
+    // Editors often save by writing a new file and renaming it over the old
+    // one, so watch the directory for both.
+    w.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w.inotify_fd >= 0 && inotify_add_watch(w.inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        close(w.inotify_fd);
+        w.inotify_fd = -1; // Fall back to polling
+    }
+#endif
+    w.world = -1;
+    w.active = true;
+    return true;
+}
+
+void closeAssetWatcher(AssetWatcher &w)
+{
+#ifdef __linux__
+    if (w.inotify_fd >= 0)
+        close(w.inotify_fd);
+#endif
+    w.inotify_fd = -1;
+    w.active = false;
+}
+
+AssetWatcher::~AssetWatcher()
+{
+    closeAssetWatcher(*this);
+}
+
+// True if the watched file may have changed since the last call.
+bool assetChanged(AssetWatcher &w)
+{
+#ifdef __linux__
+    if (w.inotify_fd >= 0)
+    {
+        alignas(inotify_event) char events[4096];
+        bool changed = false;
+        ssize_t n;
+        while ((n = read(w.inotify_fd, events, sizeof(events))) > 0)
+        {
+            for (char *p = events; p < events + n;)
+            {
+                const inotify_event *e = reinterpret_cast<const inotify_event *>(p);
+                if (e->len && strcmp(e->name, w.name) == 0)
+                    changed = true;
+                p += sizeof(inotify_event) + e->len;
+            }
+        }
+        return changed;
+    }
+#endif
+    auto now = std::chrono::steady_clock::now();
+    if (now < w.next_poll)
+        return false;
+    w.next_poll = now + std::chrono::milliseconds(ASSET_POLL_MS);
+    struct stat st;
+    if (stat(w.path, &st) != 0 || st.st_mtime == w.mtime)
+        return false;
+    w.mtime = st.st_mtime;
+    return true;
+}
+
+// Reads the watched file into w.rows. Short lines are padded with spaces and
+// long ones cut at the map width; rows past the end of the file keep what
+// the live map has. Returns the number of rows read, or -1 if the file
+// can't be opened (it may be mid-save; the next change will try again).
+int parseMapAsset(AssetWatcher &w, const char tiles[HEIGHT][WIDTH])
+{
+    FILE *f;
+    size_t size;
+    {
+        AllocationsAllowed allow; // stdio buffers
+        f = fopen(w.path, "rb");
+        if (!f)
+            return -1;
+        size = fread(w.file, 1, sizeof(w.file), f);
+        fclose(f);
+    }
+
+    int y = 0;
+    const char *p = w.file, *end = w.file + size;
+    while (y < HEIGHT && p < end)
+    {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        const char *lineEnd = eol ? eol : end;
+        int length = (int)(lineEnd - p);
+        if (length && p[length - 1] == '\r')
+            length--;
+        if (length > WIDTH)
+            length = WIDTH;
+        memcpy(w.rows[y], p, length);
+        memset(w.rows[y] + length, ' ', WIDTH - length);
+        y++;
+        p = eol ? eol + 1 : end;
+    }
+    for (int rest = y; rest < HEIGHT; rest++)
+    {
+        memcpy(w.rows[rest], tiles[rest], WIDTH);
+    }
+    return y;
+}
+
+// Copies the rows of w.rows that differ from `tiles` and updates collision
+// for the tiles that changed. Returns the mask of rows that changed.
+uint64_t applyMapAsset(AssetWatcher &w, char tiles[HEIGHT][WIDTH], CollisionMap &collision)
+{
+    uint64_t changed = 0;
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        if (memcmp(tiles[y], w.rows[y], WIDTH) == 0)
+            continue;
+        for (int x = 0; x < WIDTH; x++)
+        {
+            if (tiles[y][x] != w.rows[y][x])
+            {
+                tiles[y][x] = w.rows[y][x];
+                updateCollisionTile(collision, x, y, tiles[y][x]);
+            }
+        }
+        changed |= 1ull << y;
+    }
+    return changed;
+}
+
+// Called once a frame with the live game. Returns the rows of its map that
+// were reloaded, 0 if nothing changed.
+uint64_t pollAssetWatcher(AssetWatcher &w, GameState &g)
+{
+    if (!w.active)
+        return 0;
+    int world = g.current_world;
+    if (world != w.world)
+    {
+        // A new world was entered: watch its file and apply any edits
+        // already made to it over the built-in art.
+        w.world = world;
+        worldAssetName(world, w.name, sizeof(w.name));
+        snprintf(w.path, sizeof(w.path), "%s/%s", w.dir, w.name);
+        w.mtime = 0;
+        w.pending = true;
+    }
+    bool changed = assetChanged(w);
+    if (!changed && !w.pending)
+        return 0;
+    w.pending = false;
+    if (parseMapAsset(w, g.map) < 0)
+        return 0;
+    uint64_t rows = applyMapAsset(w, g.map, g.collision);
+    if (rows)
+    {
+        markTerrainDirty(rows);
+        w.reloads++;
+    }
+    return rows;
+}
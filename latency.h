@@ -0,0 +1,131 @@
+#pragma once
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Input latency: how long a key press takes to reach the terminal. A key is
+// stamped when getLiveInput() reads it, and its trace is marked again as the
+// frame it went into passes each stage: the tick that applied it, the layer
+// compose and the write of the frame's output. Each mark goes into a
+// histogram of microseconds since the read, so the flush histogram is the
+// lag the player sees and the others show where it builds up. Histograms
+// are fixed arrays and percentiles are read from them, so tracing a key is a
+// few clock reads and never allocates.
+enum LatencyStage
+{
+    LAT_UPDATE,  // The tick has run with the key
+    LAT_COMPOSE, // The frame showing it is composed
+    LAT_FLUSH,   // and written to the terminal
+    LAT_STAGES
+};
+
+const char *const LATENCY_STAGE_NAMES[LAT_STAGES] = {"update", "compose", "flush"};
+
+// Buckets are exact below LATENCY_LINEAR_US, then 32 to every power of two
+// (within about 3%), up to about 16 s; slower keys land in the last bucket.
+const int LATENCY_SUB_BITS = 5;
+const uint32_t LATENCY_LINEAR_US = 2u << LATENCY_SUB_BITS;
+const int LATENCY_MAX_BIT = 23;
+const int LATENCY_BUCKETS = LATENCY_LINEAR_US + (LATENCY_MAX_BIT - LATENCY_SUB_BITS) * (1 << LATENCY_SUB_BITS);
+
+struct LatencyHistogram
+{
+    uint32_t counts[LATENCY_BUCKETS];
+    uint32_t samples;
+    uint32_t max_us;
+    uint64_t total_us;
+};
+
+struct LatencyTracer
+{
+    bool pending = false; // A key is on its way to the terminal
+    std::chrono::steady_clock::time_point read_at;
+    LatencyHistogram stages[LAT_STAGES] = {};
+};
+
+LatencyTracer inputLatency;
+
+int latencyBucket(uint32_t us)
+{
+    if (us < LATENCY_LINEAR_US)
+        return (int)us;
+    int shift = (31 - std::countl_zero(us)) - LATENCY_SUB_BITS;
+    int bucket = (int)LATENCY_LINEAR_US + (shift - 1) * (1 << LATENCY_SUB_BITS) + (int)((us >> shift) - (1u << LATENCY_SUB_BITS));
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+// Middle of the range of times a bucket holds.
+uint32_t latencyBucketValue(int bucket)
+{
+    if (bucket < (int)LATENCY_LINEAR_US)
+        return (uint32_t)bucket;
+    int k = bucket - (int)LATENCY_LINEAR_US;
+    int shift = k / (1 << LATENCY_SUB_BITS) + 1;
+    uint32_t mantissa = (uint32_t)(k % (1 << LATENCY_SUB_BITS)) + (1u << LATENCY_SUB_BITS);
+    return (mantissa << shift) + (1u << (shift - 1));
+}
+
+void recordLatency(LatencyHistogram &h, uint32_t us)
+{
+    h.counts[latencyBucket(us)]++;
+    h.samples++;
+    h.total_us += us;
+    if (us > h.max_us)
+        h.max_us = us;
+}
+
+// Time within which `percent` of the samples fell; 0 with no samples.
+uint32_t latencyPercentile(const LatencyHistogram &h, int percent)
+{
+    if (h.samples == 0)
+        return 0;
+    uint64_t rank = ((uint64_t)h.samples * percent + 99) / 100;
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++)
+    {
+        seen += h.counts[b];
+        if (seen >= rank)
+        {
+            uint32_t value = latencyBucketValue(b);
+            return value < h.max_us ? value : h.max_us;
+        }
+    }
+    return h.max_us;
+}
+
+// Starts tracing a key read at `readAt`. Only one key goes into a frame, and
+// its frame is flushed before the next key is read, so one trace is enough.
+void beginInputTrace(LatencyTracer &t, std::chrono::steady_clock::time_point readAt)
+{
+    t.pending = true;
+    t.read_at = readAt;
+}
+
+// Marks the traced key, if any, as having passed `stage`; the flush ends it.
+void markInputTrace(LatencyTracer &t, LatencyStage stage)
+{
+    if (!t.pending)
+        return;
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t.read_at).count();
+    recordLatency(t.stages[stage], elapsed < 0 ? 0 : elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed);
+    if (stage == LAT_FLUSH)
+        t.pending = false;
+}
+
+void printLatencyReport(const LatencyTracer &t, FILE *out)
+{
+    if (t.stages[LAT_FLUSH].samples == 0)
+        return;
+    fprintf(out, "Input latency over %u keys, microseconds from the key being read:\n", t.stages[LAT_FLUSH].samples);
+    fprintf(out, "  %-10s %8s %8s %8s %8s %8s\n", "stage", "p50", "p95", "p99", "max", "mean");
+    for (int s = 0; s < LAT_STAGES; s++)
+    {
+        const LatencyHistogram &h = t.stages[s];
+        fprintf(out, "  %-10s %8u %8u %8u %8u %8llu\n", LATENCY_STAGE_NAMES[s], latencyPercentile(h, 50),
+                latencyPercentile(h, 95), latencyPercentile(h, 99), h.max_us,
+                h.samples ? (unsigned long long)(h.total_us / h.samples) : 0ull);
+    }
+}
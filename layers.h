@@ -0,0 +1,116 @@
+#pragma once
+#include "consoleGameEngine.h"
+#include "renderer.h"
+#include <cstdint>
+#include <cstring>
+
+// Layered frame composition.
+// A frame is built from three layers, bottom to top:
+//   terrain  - the map seen through the fog; opaque, rebuilt only when the
+//              view or the map changes
+//   entities - characters, the Floret, particles; rebuilt every frame
+//   ui       - status line and overlays
+// A zero byte in the entity and UI layers is transparent. Each layer keeps a
+// bitmask of the rows it has drawn on, so clearing and blending skip rows the
+// layer never touched. Rows are blended 32 bytes at a time with AVX2 or 16 at
+// a time with SSE2 when the compiler targets them, with a scalar fallback
+// (define ROCKY_NO_SIMD to force it).
+#if !defined(ROCKY_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define ROCKY_BLEND_AVX2
+#elif !defined(ROCKY_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define ROCKY_BLEND_SSE2
+#endif
+
+static_assert(SCREEN_HEIGHT <= 64, "Row coverage masks are 64 bits wide");
+
+struct Layer
+{
+    char cells[SCREEN_HEIGHT][WIDTH];
+    uint64_t rows = 0; // Bit y set if row y has anything drawn on it
+};
+
+Layer terrainLayer;
+Layer entityLayer;
+Layer uiLayer;
+uint64_t terrain_dirty_rows = ~0ull; // Terrain rows to rebuild before the next compose
+
+void markTerrainDirty(uint64_t rows = ~0ull)
+{
+    terrain_dirty_rows |= rows;
+}
+
+void layerPut(Layer &layer, int x, int y, char c)
+{
+    layer.cells[y][x] = c;
+    layer.rows |= 1ull << y;
+}
+
+void layerText(Layer &layer, int x, int y, const char *text, int length)
+{
+    if (x + length > WIDTH)
+        length = WIDTH - x;
+    memcpy(&layer.cells[y][x], text, length);
+    layer.rows |= 1ull << y;
+}
+
+// Makes every touched row transparent again.
+void clearLayer(Layer &layer)
+{
+    uint64_t rows = layer.rows;
+    while (rows)
+    {
+        int y = 0;
+        while (!(rows & (1ull << y)))
+            y++;
+        memset(layer.cells[y], 0, WIDTH);
+        rows &= rows - 1;
+    }
+    layer.rows = 0;
+}
+
+// dst[i] = src[i] if src[i] is non-zero, otherwise dst[i] is kept.
+void blendRow(char *dst, const char *src)
+{
+    int x = 0;
+#if defined(ROCKY_BLEND_AVX2)
+    const __m256i zero = _mm256_setzero_si256();
+    for (; x + 32 <= WIDTH; x += 32)
+    {
+        __m256i top = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x));
+        __m256i bottom = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + x));
+        __m256i transparent = _mm256_cmpeq_epi8(top, zero);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), _mm256_blendv_epi8(top, bottom, transparent));
+    }
+#elif defined(ROCKY_BLEND_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= WIDTH; x += 16)
+    {
+        __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + x));
+        __m128i transparent = _mm_cmpeq_epi8(top, zero);
+        __m128i blended = _mm_or_si128(_mm_and_si128(transparent, bottom), _mm_andnot_si128(transparent, top));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), blended);
+    }
+#endif
+    for (; x < WIDTH; x++)
+    {
+        if (src[x])
+            dst[x] = src[x];
+    }
+}
+
+// Flattens the layers into `frame`.
+void composeLayers(char frame[SCREEN_HEIGHT][WIDTH])
+{
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+    {
+        uint64_t bit = 1ull << y;
+        memcpy(frame[y], terrainLayer.cells[y], WIDTH);
+        if (entityLayer.rows & bit)
+            blendRow(frame[y], entityLayer.cells[y]);
+        if (uiLayer.rows & bit)
+            blendRow(frame[y], uiLayer.cells[y]);
+    }
+}
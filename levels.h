@@ -0,0 +1,195 @@
+#pragma once
+#include "alloctrack.h"
+#include "consoleGameEngine.h"
+#include "mechanics.h"
+#include "mapgen.h"
+#include "maps.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+// The four worlds from the objectives, played in order. Only the garden is
+// hand-drawn so far; the others are generated from fixed seeds until their
+// art exists.
+struct WorldInfo
+{
+    const char *name;
+    const char **mapData; // Hand-drawn rows, or nullptr to generate from seed
+    uint32_t seed;
+    const char *tagline;
+    int floret_x; // Where the Golden Floret stands, -1 if it isn't in this world
+    int floret_y;
+};
+
+const WorldInfo WORLDS[] = {
+    {"RIVER CAMPUS", nullptr, 1001, "Where the quest begins.", -1, -1},
+    {"DOWNTOWN ROC", nullptr, 2002, "The city lights have gone out.", -1, -1},
+    {"BEACH", nullptr, 3003, "The tide remembers the Floret's glow.", -1, -1},
+    {"GARDEN", GARDEN_MAP_DATA, 0, "Where all flowers come to bloom.", 104, 24},
+};
+
+const char FLORET_GLYPH = 'Y';
+const int FLORET_PARTICLES_PER_FRAME = 3;
+const int WORLD_COUNT = sizeof(WORLDS) / sizeof(WORLDS[0]);
+
+// Everything a world needs before it can be played, built off the main thread.
+struct LoadedWorld
+{
+    int index = -1;
+    char tiles[HEIGHT][WIDTH];
+    unsigned char collision[HEIGHT][WIDTH];
+    NPC spawns[MAX_ENEMIES];
+};
+
+// Title card shown when world `index` is entered.
+void formatWorldBanner(int index, char *out, int size)
+{
+    snprintf(out, size, "~ %s ~  %s", WORLDS[index].name, WORLDS[index].tagline);
+}
+
+const int SPAWN_MIN_DISTANCE = 30; // From the player's start, in cells
+const int SPAWN_ATTEMPTS = 256;    // Random picks per enemy before falling back to a scan
+
+bool isFreeSpawn(const LoadedWorld &world, int count, int x, int y)
+{
+    if (world.collision[y][x] & TILE_BLOCKS_MOVE)
+        return false;
+    for (int i = 0; i < count; i++)
+    {
+        if (world.spawns[i].x == x && world.spawns[i].y == y)
+            return false; // Enemies don't stack
+    }
+    return true;
+}
+
+// Picks enemy spawn points on walkable tiles away from the player's start.
+// A crowded map may have no room that far out; then the free tile furthest
+// from the start is taken, and an enemy with nowhere at all to go starts dead.
+void placeGeneratedSpawns(LoadedWorld &world, uint32_t seed)
+{
+    MapRng rng(seed ^ 0x5EED5EEDu);
+    for (int i = 0; i < MAX_ENEMIES; i++)
+    {
+        bool placed = false;
+        for (int attempt = 0; attempt < SPAWN_ATTEMPTS && !placed; attempt++)
+        {
+            int x = rng.range(1, WIDTH - 2);
+            int y = rng.range(1, HEIGHT - 2);
+            if (isFreeSpawn(world, i, x, y) && abs(x - WIDTH / 2) + abs(y - HEIGHT / 2) >= SPAWN_MIN_DISTANCE)
+            {
+                world.spawns[i] = {x, y, 'E', true};
+                placed = true;
+            }
+        }
+        if (placed)
+            continue;
+
+        int best_x = -1, best_y = -1, best_distance = -1;
+        for (int y = 1; y < HEIGHT - 1; y++)
+        {
+            for (int x = 1; x < WIDTH - 1; x++)
+            {
+                int distance = abs(x - WIDTH / 2) + abs(y - HEIGHT / 2);
+                if (distance > best_distance && isFreeSpawn(world, i, x, y))
+                {
+                    best_x = x;
+                    best_y = y;
+                    best_distance = distance;
+                }
+            }
+        }
+        world.spawns[i] = {best_x < 0 ? 1 : best_x, best_y < 0 ? 1 : best_y, 'E', best_x >= 0};
+    }
+}
+
+// Loads world `index` into `out`. Safe to call from a worker thread: it only
+// touches `out` and read-only data.
+void loadWorld(int index, uint32_t worldSeed, LoadedWorld &out)
+{
+    const WorldInfo &info = WORLDS[index];
+    out.index = index;
+
+    if (info.mapData)
+    {
+        for (int y = 0; y < HEIGHT; y++)
+        {
+            memcpy(out.tiles[y], info.mapData[y], WIDTH);
+        }
+        InitializeNPCs(out.spawns);
+    }
+    else
+    {
+        uint32_t seed = info.seed + worldSeed * 7919u;
+        GeneratedMap generated = generateBestMap(seed, WIDTH, HEIGHT);
+        for (int y = 0; y < HEIGHT; y++)
+        {
+            memcpy(out.tiles[y], &generated.tiles[y * WIDTH], WIDTH);
+        }
+    }
+
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        for (int x = 0; x < WIDTH; x++)
+        {
+            out.collision[y][x] = tileFlags(out.tiles[y][x]);
+        }
+    }
+
+    if (!info.mapData)
+    {
+        placeGeneratedSpawns(out, info.seed + worldSeed * 7919u);
+    }
+}
+
+// Loads the next world on a worker thread while the current one is played.
+// Only the live game streams; batch games share worlds loaded up front.
+// The worker only writes `staged` and then publishes it with `ready`; the
+// game copies it into the live map in one step when the player crosses over.
+struct LevelStreamer
+{
+    LoadedWorld staged;
+    std::thread worker;
+    std::atomic<bool> ready{false};
+    int requested = -1;
+
+    ~LevelStreamer()
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+};
+
+LevelStreamer levelStreamer;
+
+void preloadWorld(LevelStreamer &s, int index, uint32_t worldSeed)
+{
+    if (index < 0 || index >= WORLD_COUNT || s.requested == index)
+        return;
+    if (s.worker.joinable())
+        s.worker.join();
+    s.ready.store(false, std::memory_order_relaxed);
+    s.requested = index;
+    AllocationsAllowed allow; // Starting the thread allocates; the loading itself is off the game thread
+    s.worker = std::thread([&s, index, worldSeed]()
+                           {
+                               loadWorld(index, worldSeed, s.staged);
+                               s.ready.store(true, std::memory_order_release); });
+}
+
+bool isWorldReady(const LevelStreamer &s, int index)
+{
+    return s.requested == index && s.ready.load(std::memory_order_acquire);
+}
+
+// Returns the loaded world, waiting only if it wasn't preloaded in time (or
+// at all, as for the first world). The staged buffer is reused by the next
+// preload, so callers copy what they need before requesting another world.
+const LoadedWorld &takeWorld(LevelStreamer &s, int index, uint32_t worldSeed)
+{
+    preloadWorld(s, index, worldSeed);
+    if (s.worker.joinable())
+        s.worker.join();
+    s.requested = -1;
+    return s.staged;
+}
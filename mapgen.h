@@ -0,0 +1,324 @@
+#pragma once
+#include "consoleGameEngine.h"
+#include "mechanics.h"
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Seeded procedural maps.
+// Maps are built from the same glyphs as the hand-drawn ones in maps.h, so
+// isObstacle() and the collision map work on them unchanged:
+//   ' ' grass, '.' paths and border, '^' flowers,
+//   ponds: '~' water ringed by '_' '-' '{' '}' '/' '\'
+//   trees: '(##)' crowns over '||' trunks
+// Several candidates are generated in parallel from seeds derived from the
+// map seed and checked for connectivity with union-find; the first candidate
+// (in seed order, not finishing order) that passes is used, so a seed always gives
+// the same map.
+const int MAPGEN_CANDIDATES = 4;
+const float MAPGEN_MIN_CONNECTED = 0.98f; // Share of walkable tiles that must be reachable from the spawn
+
+struct GeneratedMap
+{
+    int width = 0;
+    int height = 0;
+    uint32_t seed = 0;
+    bool connected = false;
+    std::vector<char> tiles; // Row-major, width * height
+
+    char &at(int x, int y) { return tiles[y * width + x]; }
+    char at(int x, int y) const { return tiles[y * width + x]; }
+};
+
+// Each generator has its own xorshift state so candidates can run on
+// separate threads without touching the game's RNG.
+struct MapRng
+{
+    uint32_t state;
+
+    explicit MapRng(uint32_t seed) : state(seed ? seed : 0x2545F491) {}
+
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    int range(int lo, int hi) // Inclusive
+    {
+        return lo + (int)(next() % (uint32_t)(hi - lo + 1));
+    }
+};
+
+struct UnionFind
+{
+    std::vector<int> parent;
+
+    explicit UnionFind(int n) : parent(n)
+    {
+        for (int i = 0; i < n; i++)
+            parent[i] = i;
+    }
+
+    int find(int a)
+    {
+        while (parent[a] != a)
+        {
+            parent[a] = parent[parent[a]]; // Path halving
+            a = parent[a];
+        }
+        return a;
+    }
+
+    void unite(int a, int b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a != b)
+            parent[a < b ? b : a] = a < b ? a : b;
+    }
+};
+
+bool isGeneratedTileWalkable(char tile)
+{
+    return !isObstacle(tile);
+}
+
+// Lays a path of '.' from (x0, y0) to (x1, y1), wandering a little.
+void carvePath(GeneratedMap &m, std::vector<bool> &reserved, MapRng &rng, int x0, int y0, int x1, int y1)
+{
+    int x = x0, y = y0;
+    while (x != x1 || y != y1)
+    {
+        m.at(x, y) = '.';
+        reserved[y * m.width + x] = true;
+        bool horizontal = x != x1 && (y == y1 || rng.range(0, 2) != 0);
+        if (horizontal)
+            x += x1 > x ? 1 : -1;
+        else
+            y += y1 > y ? 1 : -1;
+    }
+    m.at(x, y) = '.';
+    reserved[y * m.width + x] = true;
+}
+
+bool areaFree(const GeneratedMap &m, const std::vector<bool> &reserved, int x0, int y0, int x1, int y1)
+{
+    if (x0 < 1 || y0 < 1 || x1 >= m.width - 1 || y1 >= m.height - 1)
+        return false;
+    for (int y = y0; y <= y1; y++)
+    {
+        for (int x = x0; x <= x1; x++)
+        {
+            if (reserved[y * m.width + x])
+                return false;
+        }
+    }
+    return true;
+}
+
+void reserveArea(GeneratedMap &m, std::vector<bool> &reserved, int x0, int y0, int x1, int y1)
+{
+    for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+            reserved[y * m.width + x] = true;
+}
+
+// An ellipse of water whose outermost cells become the pond's rim.
+// Returns false if the spot was taken so the caller can try elsewhere.
+bool placePond(GeneratedMap &m, std::vector<bool> &reserved, MapRng &rng)
+{
+    int rx = rng.range(6, 14);
+    int ry = rng.range(3, 5);
+    int cx = rng.range(rx + 2, m.width - rx - 3);
+    int cy = rng.range(ry + 2, m.height - ry - 3);
+    if (!areaFree(m, reserved, cx - rx - 1, cy - ry - 1, cx + rx + 1, cy + ry + 1))
+        return false;
+
+    auto inside = [&](int x, int y)
+    {
+        float nx = (x - cx) / (rx + 0.5f), ny = (y - cy) / (ry + 0.5f);
+        return nx * nx + ny * ny <= 1.0f;
+    };
+
+    for (int y = cy - ry; y <= cy + ry; y++)
+    {
+        for (int x = cx - rx; x <= cx + rx; x++)
+        {
+            if (!inside(x, y))
+                continue;
+            bool up = inside(x, y - 1), down = inside(x, y + 1);
+            bool left = inside(x - 1, y), right = inside(x + 1, y);
+            char c = '~';
+            if (!up && !left)
+                c = '/';
+            else if (!up && !right)
+                c = '\\';
+            else if (!down && !left)
+                c = '\\';
+            else if (!down && !right)
+                c = '/';
+            else if (!up)
+                c = '_';
+            else if (!down)
+                c = '-';
+            else if (!left)
+                c = '{';
+            else if (!right)
+                c = '}';
+            m.at(x, y) = c;
+        }
+    }
+    reserveArea(m, reserved, cx - rx - 1, cy - ry - 1, cx + rx + 1, cy + ry + 1);
+    return true;
+}
+
+bool placeTree(GeneratedMap &m, std::vector<bool> &reserved, MapRng &rng)
+{
+    int x = rng.range(2, m.width - 6);
+    int y = rng.range(2, m.height - 4);
+    if (!areaFree(m, reserved, x - 1, y - 1, x + 4, y + 2))
+        return false;
+    const char *crown = "(##)";
+    for (int i = 0; i < 4; i++)
+        m.at(x + i, y) = crown[i];
+    m.at(x + 1, y + 1) = '|';
+    m.at(x + 2, y + 1) = '|';
+    reserveArea(m, reserved, x, y, x + 3, y + 1);
+    return true;
+}
+
+// Joins every walkable tile with its walkable neighbours; returns how many
+// walkable tiles there are.
+int connectWalkable(const GeneratedMap &m, UnionFind &uf)
+{
+    const int w = m.width, h = m.height;
+    int walkable = 0;
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            if (!isGeneratedTileWalkable(m.at(x, y)))
+                continue;
+            walkable++;
+            if (x > 0 && isGeneratedTileWalkable(m.at(x - 1, y)))
+                uf.unite(y * w + x, y * w + x - 1);
+            if (y > 0 && isGeneratedTileWalkable(m.at(x, y - 1)))
+                uf.unite(y * w + x, (y - 1) * w + x);
+        }
+    }
+    return walkable;
+}
+
+// Checks that the walkable tiles reachable from the spawn make up at least
+// MAPGEN_MIN_CONNECTED of all walkable tiles.
+bool validateConnectivity(const GeneratedMap &m, int spawn_x, int spawn_y)
+{
+    const int w = m.width, h = m.height;
+    UnionFind uf(w * h);
+    int walkable = connectWalkable(m, uf);
+    if (!isGeneratedTileWalkable(m.at(spawn_x, spawn_y)))
+        return false;
+
+    int root = uf.find(spawn_y * w + spawn_x);
+    int reachable = 0;
+    for (int i = 0; i < w * h; i++)
+    {
+        if (isGeneratedTileWalkable(m.tiles[i]) && uf.find(i) == root)
+            reachable++;
+    }
+    return reachable >= walkable * MAPGEN_MIN_CONNECTED;
+}
+
+// Grows thicket ('#') over walkable pockets the spawn can't reach, so
+// enemies and patrol points placed on any walkable tile can reach the player.
+void fillUnreachable(GeneratedMap &m, int spawn_x, int spawn_y)
+{
+    const int w = m.width, h = m.height;
+    UnionFind uf(w * h);
+    connectWalkable(m, uf);
+    if (!isGeneratedTileWalkable(m.at(spawn_x, spawn_y)))
+        return;
+    int root = uf.find(spawn_y * w + spawn_x);
+    for (int i = 0; i < w * h; i++)
+    {
+        if (isGeneratedTileWalkable(m.tiles[i]) && uf.find(i) != root)
+            m.tiles[i] = '#';
+    }
+}
+
+// Generates one candidate. The spawn is the centre of the map, the same
+// place the player starts on the hand-drawn maps.
+void generateMap(uint32_t seed, int width, int height, GeneratedMap &m)
+{
+    MapRng rng(seed);
+    m.width = width;
+    m.height = height;
+    m.seed = seed;
+    m.tiles.assign(width * height, ' ');
+    std::vector<bool> reserved(width * height, false);
+
+    for (int x = 0; x < width; x++)
+    {
+        m.at(x, 0) = '.';
+        m.at(x, height - 1) = '.';
+    }
+    for (int y = 0; y < height; y++)
+    {
+        m.at(0, y) = '.';
+        m.at(width - 1, y) = '.';
+    }
+
+    // Paths from the spawn out to a few landmarks; features never cover them.
+    int cx = width / 2, cy = height / 2;
+    int area = width * height;
+    int landmarks = 3 + area / 4000;
+    for (int i = 0; i < landmarks; i++)
+    {
+        carvePath(m, reserved, rng, cx, cy, rng.range(2, width - 3), rng.range(2, height - 3));
+    }
+
+    // Each feature gets a few attempts before we give up on it.
+    for (int placed = 0, tries = 0, ponds = 2 + area / 3000; placed < ponds && tries < ponds * 8; tries++)
+        placed += placePond(m, reserved, rng) ? 1 : 0;
+    for (int placed = 0, tries = 0, trees = 6 + area / 250; placed < trees && tries < trees * 4; tries++)
+        placed += placeTree(m, reserved, rng) ? 1 : 0;
+    for (int i = 0, flowers = area / 200; i < flowers; i++)
+    {
+        int x = rng.range(1, width - 2), y = rng.range(1, height - 2);
+        if (m.at(x, y) == ' ')
+            m.at(x, y) = '^';
+    }
+
+    m.connected = validateConnectivity(m, cx, cy);
+}
+
+// Builds MAPGEN_CANDIDATES maps on worker threads and returns the first
+// connected one. If none pass, the best effort is the first candidate.
+// Whatever the spawn can't reach is filled in either way.
+GeneratedMap generateBestMap(uint32_t seed, int width, int height)
+{
+    std::vector<GeneratedMap> candidates(MAPGEN_CANDIDATES);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < MAPGEN_CANDIDATES; i++)
+    {
+        workers.emplace_back([&candidates, i, seed, width, height]()
+                             { generateMap(seed + (uint32_t)i * 0x9E3779B9u, width, height, candidates[i]); });
+    }
+    for (std::thread &t : workers)
+        t.join();
+
+    GeneratedMap *best = &candidates[0];
+    for (GeneratedMap &m : candidates)
+    {
+        if (m.connected)
+        {
+            best = &m;
+            break;
+        }
+    }
+    fillUnreachable(*best, width / 2, height / 2);
+    return std::move(*best);
+}
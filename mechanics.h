@@ -1,22 +1,46 @@
 #pragma once
 #include "consoleGameEngine.h"
+#include <cstdint>
+
+// Per-game random number generator (xorshift32). Everything random in the
+// simulation must come from its game's generator (GameState::rng) so that a
+// recorded seed replays exactly.
+void seedRandom(uint32_t &state, uint32_t seed)
+{
+    state = seed ? seed : 0x9E3779B9; // xorshift gets stuck on 0
+}
+
+uint32_t nextRandom(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
 // Add to your global definitions
 struct NPC {
     int x;
     int y;
     char character = 'E'; // E for Enemy
     bool is_alive = true;
+    int goal_x = -1; // Patrol target, -1 if the NPC just chases the player
+    int goal_y = -1;
+    int home_x = -1; // Where the patrol turns around
+    int home_y = -1;
 };
 
-// Global NPC array (or vector, for C++ flexibility)
+// Enemies on patrol break off and chase when the player gets this close.
+const int PATROL_CHASE_RANGE = 12;
+
 const int MAX_ENEMIES = 3;
-NPC enemies[MAX_ENEMIES];
 
-void InitializeNPCs() {
+// Garden enemy placement. Writes into `out` so worlds can be prepared off the
+// live game's enemies.
+void InitializeNPCs(NPC *out) {
     // Example placement on traversable terrain (e.g., grass '.')
-    enemies[0] = {10, 10, 'E', true};
-    enemies[1] = {50, 20, 'E', true};
-    enemies[2] = {120, 35, 'E', true};
+    out[0] = {10, 10, 'E', true};
+    out[1] = {50, 20, 'E', true};
+    out[2] = {120, 35, 'E', true, 120, 5, 120, 35}; // Patrols up and down the east side
 }
 
 bool isObstacle(char tile)
@@ -47,8 +71,48 @@ bool isObstacle(char tile)
     return false; // Return false for all other traversable characters
 }
 
-void handleAttack(int dx, int dy) {
-    if (dx == 0 && dy == 0 ) {
-        
+// Collision data derived from the map, one byte of flags per tile, so hot
+// loops (field of view, pathfinding) don't re-run isObstacle() on glyphs.
+// The version changes whenever any tile changes so caches built on top of
+// it know when to rebuild.
+const unsigned char TILE_BLOCKS_MOVE = 1;
+const unsigned char TILE_BLOCKS_SIGHT = 2;
+
+struct CollisionMap
+{
+    unsigned char flags[HEIGHT][WIDTH];
+    unsigned int version = 0;
+};
+
+bool blocksSight(char tile)
+{
+    // Trees, trunks and walls are tall; water and pond edges can be seen across.
+    return tile == '#' || tile == '(' || tile == ')' || tile == '|' || tile == 'B';
+}
+
+unsigned char tileFlags(char tile)
+{
+    return (isObstacle(tile) ? TILE_BLOCKS_MOVE : 0) | (blocksSight(tile) ? TILE_BLOCKS_SIGHT : 0);
+}
+
+void buildCollisionMap(CollisionMap &c, const char tiles[HEIGHT][WIDTH])
+{
+    for (int y = 0; y < HEIGHT; y++)
+    {
+        for (int x = 0; x < WIDTH; x++)
+        {
+            c.flags[y][x] = tileFlags(tiles[y][x]);
+        }
     }
-}
\ No newline at end of file
+    c.version++;
+}
+
+void updateCollisionTile(CollisionMap &c, int x, int y, char tile)
+{
+    unsigned char flags = tileFlags(tile);
+    if (c.flags[y][x] != flags)
+    {
+        c.flags[y][x] = flags;
+        c.version++;
+    }
+}
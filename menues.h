@@ -1,55 +1,195 @@
 #pragma once
 #include "consoleGameEngine.h"
+#include "levels.h"
+#include "renderer.h"
+#include <cstring>
 
+// Menus are drawn once into a cached frame (full-screen menus) or a cached
+// box (overlays) and then sent with the frame renderer, so showing a menu is
+// a single write. Overlays are laid over a frozen copy of the game frame;
+// the game underneath isn't redrawn, and because the renderer only sends
+// changed cells, opening or closing one only touches the cells of the box.
+const int MENU_MAX_ITEMS = 8;
+const int MENU_LABEL_MAX = 40;
+const int MENU_BOX_WIDTH = MENU_LABEL_MAX + 14; // Border, padding and the "[k]  " before each label
+const int MENU_BOX_HEIGHT = MENU_MAX_ITEMS + 6;
+const int MENU_KEY_BACK = KEY_ESCAPE; // Esc leaves any menu
 
-bool titleScreen()
+struct MenuItem
+{
+    int key;
+    char label[MENU_LABEL_MAX];
+};
+
+struct Menu
 {
-    system("cls");
+    const char *title;
+    MenuItem items[MENU_MAX_ITEMS];
+    int item_count = 0;
+    int x = 0; // Where the box goes on screen
+    int y = 0;
+    int w = 0;
+    int h = 0;
+    char box[MENU_BOX_HEIGHT][MENU_BOX_WIDTH]; // Pre-rendered, built on first use
+    bool built = false;
+};
+
+char menuFrame[SCREEN_HEIGHT][WIDTH]; // Frozen game frame with a menu on top
+
+void addMenuItem(Menu &m, int key, const char *label)
+{
+    if (m.item_count == MENU_MAX_ITEMS)
+        return;
+    MenuItem &item = m.items[m.item_count++];
+    item.key = key;
+    snprintf(item.label, sizeof(item.label), "%s", label);
+}
+
+// Renders the box: a border, the title, a blank line, then one line per item.
+void buildMenu(Menu &m)
+{
+    int widest = (int)strlen(m.title);
+    for (int i = 0; i < m.item_count; i++)
+    {
+        int len = 6 + (int)strlen(m.items[i].label); // "[k]  label"
+        widest = len > widest ? len : widest;
+    }
+    m.w = widest + 8;
+    m.h = m.item_count + 6;
+    m.x = (WIDTH - m.w) / 2;
+    m.y = (HEIGHT - m.h) / 2;
+
+    for (int y = 0; y < m.h; y++)
+    {
+        char *row = m.box[y];
+        bool edge = y == 0 || y == m.h - 1;
+        memset(row, edge ? '-' : ' ', m.w);
+        row[0] = row[m.w - 1] = edge ? '+' : '|';
+    }
+    memcpy(&m.box[2][(m.w - strlen(m.title)) / 2], m.title, strlen(m.title));
+    for (int i = 0; i < m.item_count; i++)
+    {
+        char *row = &m.box[4 + i][4];
+        const MenuItem &item = m.items[i];
+        row[0] = '[';
+        row[1] = (char)item.key;
+        row[2] = ']';
+        memcpy(row + 5, item.label, strlen(item.label));
+    }
+    m.built = true;
+}
+
+// Shows `m` over `base` (normally the last game frame).
+void presentMenu(Menu &m, const char base[SCREEN_HEIGHT][WIDTH])
+{
+    if (!m.built)
+        buildMenu(m);
+    memcpy(menuFrame, base, sizeof(menuFrame));
+    for (int y = 0; y < m.h; y++)
+    {
+        memcpy(&menuFrame[m.y + y][m.x], m.box[y], m.w);
+    }
+    presentFrame(renderer, menuFrame);
+}
+
+// Shows the menu and waits for one of its keys (or Esc), which it returns.
+int runMenu(Menu &m, const char base[SCREEN_HEIGHT][WIDTH])
+{
+    presentMenu(m, base);
+    while (true)
+    {
+        int choice = getLiveInput();
+        if (choice == MENU_KEY_BACK)
+            return choice;
+        for (int i = 0; i < m.item_count; i++)
+        {
+            if (m.items[i].key == choice)
+                return choice;
+        }
+        if (handleConsoleResize(renderer))
+        {
+            presentFrame(renderer, menuFrame);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+Menu pauseMenu;
+Menu levelMenu;
+Menu quitMenu;
+
+// Fills in the in-game menus; called once before the game loop.
+void initializeMenus()
+{
+    pauseMenu.title = "PAUSED";
+    addMenuItem(pauseMenu, 'p', "Resume");
+    addMenuItem(pauseMenu, 'l', "Level select");
+    addMenuItem(pauseMenu, 'q', "Quit");
+
+    levelMenu.title = "SELECT A WORLD";
+    for (int i = 0; i < WORLD_COUNT && i < 9; i++)
+    {
+        addMenuItem(levelMenu, '1' + i, WORLDS[i].name);
+    }
+
+    quitMenu.title = "QUIT THE GAME?";
+    addMenuItem(quitMenu, 'y', "Yes");
+    addMenuItem(quitMenu, 'n', "No");
+}
+
+// ------------------------------- TITLE SCREEN ------------------------------------------------
+const char *const TITLE_LOGO[] = {
+    R"(  ________            _____                            ____   ____             __        )",
+    R"( /_  __/ /_  ___     / ___/____ _____ _____ _   ____  / __/  / __ \____  _____/ /____  __)",
+    R"(  / / / __ \/ _ \    \__ \/ __ `/ __ `/ __ `/  / __ \/ /_   / /_/ / __ \/ ___/ //_/ / / /)",
+    R"( / / / / / /  __/   ___/ / /_/ / /_/ / /_/ /  / /_/ / __/  / _, _/ /_/ / /__/ ,< / /_/ / )",
+    R"(/_/ /_/ /_/\___/   /____/\__,_/\__, /\__,_/   \____/_/    /_/ |_|\____/\___/_/|_|\__, /  )",
+    R"(                              /____/                                            /____/   )",
+    R"( )",
+    R"(   ___       ___     __   __        __   ___          ___       __   __   ___ ___ )",
+    R"(    |  |__| |__     / _` /  \ |    |  \ |__  |\ |    |__  |    /  \ |__) |__   |  )",
+    R"(    |  |  | |___    \__> \__/ |___ |__/ |___ | \|    |    |___ \__/ |  \ |___  |  )",
+};
+
+char titleFrame[SCREEN_HEIGHT][WIDTH];
+bool titleFrameBuilt = false;
+
+void buildTitleFrame()
+{
+    memset(titleFrame, ' ', sizeof(titleFrame));
     for (int y = 0; y < HEIGHT; y++)
     {
         for (int x = 0; x < WIDTH; x++)
         {
             if (x == 0 || x == WIDTH - 1 || y == 0 || y == HEIGHT - 1)
             {
-                drawChar(x, y, '*');
+                titleFrame[y][x] = '*';
             }
         }
     }
 
     int x = 35;
     int y = 10;
+    for (const char *line : TITLE_LOGO)
+    {
+        memcpy(&titleFrame[y++][x], line, strlen(line));
+    }
+
+    const char begin[] = ">> Press spacebar to begin";
+    const char quit[] = ">> Press q to quit";
+    memcpy(&titleFrame[25][63], begin, sizeof(begin) - 1);
+    memcpy(&titleFrame[26][63], quit, sizeof(quit) - 1);
+    titleFrameBuilt = true;
+}
 
-    goToXY(x, y);
-    std::cout << R"(  ________            _____                            ____   ____             __        )" << std::endl;
-    goToXY(x, ++y);
-    std::cout << R"( /_  __/ /_  ___     / ___/____ _____ _____ _   ____  / __/  / __ \____  _____/ /____  __)" << std::endl;
-    goToXY(x, ++y);
-    std::cout << R"(  / / / __ \/ _ \    \__ \/ __ `/ __ `/ __ `/  / __ \/ /_   / /_/ / __ \/ ___/ //_/ / / /)" << std::endl;
-    goToXY(x, ++y);
-    std::cout << R"( / / / / / /  __/   ___/ / /_/ / /_/ / /_/ /  / /_/ / __/  / _, _/ /_/ / /__/ ,< / /_/ / )" << std::endl;
-    goToXY(x, ++y);
-    std::cout << R"(/_/ /_/ /_/\___/   /____/\__,_/\__, /\__,_/   \____/_/    /_/ |_|\____/\___/_/|_|\__, /  )" << std::endl;
-    goToXY(x, ++y);
-    std::cout << R"(                              /____/                                            /____/   )" << std::endl;
-    goToXY(x, ++y);
-    std::cout << R"( )" << std::endl;
-    goToXY(x, ++y);
-    std::cout << R"(   ___       ___     __   __        __   ___          ___       __   __   ___ ___ )" << std::endl;
-    goToXY(x, ++y);
-    std::cout << R"(    |  |__| |__     / _` /  \ |    |  \ |__  |\ |    |__  |    /  \ |__) |__   |  )" << std::endl;
-    goToXY(x, ++y);
-    std::cout << R"(    |  |  | |___    \__> \__/ |___ |__/ |___ | \|    |    |___ \__/ |  \ |___  |  )" << std::endl;
-    goToXY(x, ++y);
-    std::cout << R"()";
-    goToXY(x, ++y);
-
-    x = 63;
-    y = 25;
-
-    goToXY(x, y);
-    std::cout << ">> Press spacebar to begin";
-    goToXY(x, y + 1);
-    std::cout << ">> Press q to quit";
+bool titleScreen()
+{
+    if (!titleFrameBuilt)
+    {
+        buildTitleFrame();
+    }
+    invalidateScreen(renderer); // Whatever was on screen before, send the whole frame
+    presentFrame(renderer, titleFrame);
 
     while (true)
     {
@@ -63,5 +203,10 @@ bool titleScreen()
         {
             return false;
         }
+        if (handleConsoleResize(renderer))
+        {
+            presentFrame(renderer, titleFrame);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
-}
\ No newline at end of file
+}
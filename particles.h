@@ -0,0 +1,159 @@
+#pragma once
+#include "consoleGameEngine.h"
+#include <cmath>
+#include <cstdint>
+
+// Particle effects (sparkles, dandelion seeds, bursts).
+// Particles are stored structure-of-arrays in a fixed pool, so the update
+// loop streams through a few flat float arrays. Free slots are chained in a
+// free list and live slots are kept in a dense `active` list, so spawning,
+// killing and iterating never allocate and never scan dead slots.
+// Particles are purely cosmetic: they use their own RNG and are not part of
+// the game state, snapshots or replays.
+const int MAX_PARTICLES = 8192;
+
+struct ParticlePool
+{
+    float x[MAX_PARTICLES];
+    float y[MAX_PARTICLES];
+    float vx[MAX_PARTICLES];
+    float vy[MAX_PARTICLES];
+    float ay[MAX_PARTICLES];   // Vertical acceleration: gravity for bursts, lift for seeds
+    float life[MAX_PARTICLES]; // Seconds left to live
+    char glyph[MAX_PARTICLES];
+    uint8_t kind[MAX_PARTICLES];
+
+    int32_t next_free[MAX_PARTICLES];
+    int32_t free_head = -1;
+    int32_t active[MAX_PARTICLES];
+    int32_t active_count = 0;
+    uint32_t rng = 0x1234567;
+};
+
+enum ParticleKind : uint8_t
+{
+    PARTICLE_SPARKLE, // Twinkles between glyphs while it lives
+    PARTICLE_SEED,    // Drifts up and sways
+    PARTICLE_BURST    // Flies out and falls
+};
+
+ParticlePool particles;
+
+void resetParticles(ParticlePool &p)
+{
+    p.active_count = 0;
+    p.free_head = 0;
+    for (int i = 0; i < MAX_PARTICLES - 1; i++)
+        p.next_free[i] = i + 1;
+    p.next_free[MAX_PARTICLES - 1] = -1;
+}
+
+float particleRandom(ParticlePool &p) // In [0, 1)
+{
+    p.rng ^= p.rng << 13;
+    p.rng ^= p.rng >> 17;
+    p.rng ^= p.rng << 5;
+    return (p.rng >> 8) * (1.0f / 16777216.0f);
+}
+
+// Returns false when the pool is full; effects just get a little thinner.
+bool spawnParticle(ParticlePool &p, ParticleKind kind, float x, float y, float vx, float vy, float ay, float life, char glyph)
+{
+    if (p.free_head < 0)
+        return false;
+    int i = p.free_head;
+    p.free_head = p.next_free[i];
+
+    p.x[i] = x;
+    p.y[i] = y;
+    p.vx[i] = vx;
+    p.vy[i] = vy;
+    p.ay[i] = ay;
+    p.life[i] = life;
+    p.glyph[i] = glyph;
+    p.kind[i] = kind;
+    p.active[p.active_count++] = i;
+    return true;
+}
+
+// Sparkles twinkling and seeds floating up around a point, e.g. the Golden Floret.
+void emitFloretEffects(ParticlePool &p, float cx, float cy, int count)
+{
+    for (int n = 0; n < count; n++)
+    {
+        float r = particleRandom(p);
+        if (r < 0.6f)
+        {
+            float ox = (particleRandom(p) - 0.5f) * 12.0f;
+            float oy = (particleRandom(p) - 0.5f) * 5.0f;
+            spawnParticle(p, PARTICLE_SPARKLE, cx + ox, cy + oy, 0.0f, 0.0f, 0.0f, 0.3f + particleRandom(p) * 0.6f, '*');
+        }
+        else
+        {
+            float vx = (particleRandom(p) - 0.5f) * 4.0f;
+            float vy = -1.0f - particleRandom(p) * 2.0f;
+            spawnParticle(p, PARTICLE_SEED, cx, cy, vx, vy, -0.5f, 2.0f + particleRandom(p) * 3.0f, '.');
+        }
+    }
+}
+
+// A ring of particles flying out from a point, e.g. arriving in a new world.
+void emitBurst(ParticlePool &p, float cx, float cy, int count, char glyph)
+{
+    for (int n = 0; n < count; n++)
+    {
+        float vx = (particleRandom(p) - 0.5f) * 40.0f; // Cells are twice as tall as wide
+        float vy = (particleRandom(p) - 0.5f) * 20.0f;
+        spawnParticle(p, PARTICLE_BURST, cx, cy, vx, vy, 12.0f, 0.4f + particleRandom(p) * 0.5f, glyph);
+    }
+}
+
+// Advances every live particle by dt seconds (semi-implicit Euler) and
+// returns dead slots to the free list.
+void updateParticles(ParticlePool &p, float dt)
+{
+    static const char twinkle[4] = {'*', '+', '.', '+'};
+
+    for (int n = 0; n < p.active_count;)
+    {
+        int i = p.active[n];
+        p.life[i] -= dt;
+        if (p.life[i] <= 0.0f)
+        {
+            p.next_free[i] = p.free_head;
+            p.free_head = i;
+            p.active[n] = p.active[--p.active_count]; // Swap-remove, order doesn't matter
+            continue;
+        }
+
+        p.vy[i] += p.ay[i] * dt;
+        p.x[i] += p.vx[i] * dt;
+        p.y[i] += p.vy[i] * dt;
+
+        if (p.kind[i] == PARTICLE_SPARKLE)
+        {
+            p.glyph[i] = twinkle[(int)(p.life[i] * 12.0f) & 3];
+        }
+        else if (p.kind[i] == PARTICLE_SEED)
+        {
+            p.vx[i] += (particleRandom(p) - 0.5f) * 6.0f * dt; // Sway in the breeze
+        }
+        n++;
+    }
+}
+
+// Hands every live particle that is on the map to `plot(x, y, glyph)`; the
+// caller decides where particles may show (blank ground, outside the fog).
+template <typename Plot>
+void drawParticles(const ParticlePool &p, Plot plot)
+{
+    for (int n = 0; n < p.active_count; n++)
+    {
+        int i = p.active[n];
+        int x = (int)floorf(p.x[i] + 0.5f); // A plain cast truncates, putting -0.7 on column 0
+        int y = (int)floorf(p.y[i] + 0.5f);
+        if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT)
+            continue;
+        plot(x, y, p.glyph[i]);
+    }
+}
@@ -0,0 +1,282 @@
+#pragma once
+#include "consoleGameEngine.h"
+#include "mechanics.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// A* pathfinding over the collision map.
+// Every step costs 1 and the heuristic is the Manhattan distance, so f-costs
+// are small integers and the open list can be a bucket queue: one intrusive
+// doubly linked list per f value, found by scanning up from the lowest
+// non-empty bucket. All node storage is preallocated; a search id stamp
+// marks which nodes belong to the current search so nothing is cleared
+// between queries. Results go into a small cache keyed by start and goal.
+// Each game has its own Pathfinder, so games on different threads can
+// search at the same time.
+const int PATH_NODES = WIDTH * HEIGHT;
+const int PATH_MAX_F = WIDTH + HEIGHT + PATH_NODES; // Upper bound on g + h
+const int PATH_CACHE_SLOTS = 64;
+const int PATH_CACHE_MAX_LEN = 512; // Longer paths are returned but not cached
+
+struct PathStep
+{
+    int16_t x;
+    int16_t y;
+};
+
+struct PathNode
+{
+    uint32_t search; // Node data is valid only if this equals Pathfinder::search_id
+    int32_t g;
+    int32_t parent;
+    int32_t prev; // Open list links
+    int32_t next;
+    bool closed;
+};
+
+struct PathCacheEntry
+{
+    uint32_t version; // CollisionMap::version the path was computed for
+    int32_t start;
+    int32_t goal;
+    int32_t length;
+    PathStep steps[PATH_CACHE_MAX_LEN];
+};
+
+struct Pathfinder
+{
+    PathNode nodes[PATH_NODES];
+    int32_t buckets[PATH_MAX_F + 1];
+    uint32_t bucket_search[PATH_MAX_F + 1]; // Bucket heads are stamped the same way as nodes
+    uint32_t search_id = 0;
+    PathCacheEntry cache[PATH_CACHE_SLOTS];
+    PathStep steps[PATH_NODES]; // Scratch for nextStepToward()
+
+    // Statistics, handy for checking the cache is doing its job.
+    unsigned int queries = 0;
+    unsigned int cache_hits = 0;
+};
+
+int pathHeuristic(int index, int gx, int gy)
+{
+    return abs(index % WIDTH - gx) + abs(index / WIDTH - gy);
+}
+
+int32_t &bucketHead(Pathfinder &pf, int f)
+{
+    if (pf.bucket_search[f] != pf.search_id)
+    {
+        pf.bucket_search[f] = pf.search_id;
+        pf.buckets[f] = -1;
+    }
+    return pf.buckets[f];
+}
+
+void openListPush(Pathfinder &pf, int index, int f)
+{
+    int32_t &head = bucketHead(pf, f);
+    PathNode &n = pf.nodes[index];
+    n.prev = -1;
+    n.next = head;
+    if (head >= 0)
+        pf.nodes[head].prev = index;
+    head = index;
+}
+
+void openListRemove(Pathfinder &pf, int index, int f)
+{
+    PathNode &n = pf.nodes[index];
+    if (n.prev >= 0)
+        pf.nodes[n.prev].next = n.next;
+    else
+        bucketHead(pf, f) = n.next;
+    if (n.next >= 0)
+        pf.nodes[n.next].prev = n.prev;
+}
+
+bool isWalkable(const CollisionMap &c, int x, int y)
+{
+    return x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT && !(c.flags[y][x] & TILE_BLOCKS_MOVE);
+}
+
+// Copies the tail of a cached path beginning at `from` into out. Returns its
+// length, or -1 if it doesn't fit in maxSteps, the same as a search would.
+int copyCachedPath(const PathCacheEntry &e, int from, PathStep *out, int maxSteps)
+{
+    int n = e.length - from;
+    if (n > maxSteps)
+        return -1;
+    memcpy(out, e.steps + from, n * sizeof(PathStep));
+    return n;
+}
+
+// Looks for a cached path from start to goal. Besides an exact hit, an NPC
+// walking along a path it asked for earlier will be standing on one of its
+// steps, so the entry for the goal's slot is also searched for the start.
+// Returns true on a hit, with `length` as findPath() would return it.
+bool lookupCachedPath(const Pathfinder &pf, unsigned int version, int start, int goal, PathStep *out, int maxSteps, int &length)
+{
+    unsigned int slot = ((unsigned int)start * 2654435761u ^ (unsigned int)goal) % PATH_CACHE_SLOTS;
+    const PathCacheEntry &exact = pf.cache[slot];
+    if (exact.version == version && exact.start == start && exact.goal == goal)
+    {
+        length = copyCachedPath(exact, 0, out, maxSteps);
+        return true;
+    }
+
+    const PathCacheEntry &byGoal = pf.cache[(unsigned int)goal % PATH_CACHE_SLOTS];
+    if (byGoal.version == version && byGoal.goal == goal)
+    {
+        int sx = start % WIDTH, sy = start / WIDTH;
+        for (int i = 0; i < byGoal.length; i++)
+        {
+            if (byGoal.steps[i].x == sx && byGoal.steps[i].y == sy)
+            {
+                length = copyCachedPath(byGoal, i + 1, out, maxSteps);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void storeCachedPath(Pathfinder &pf, unsigned int version, int start, int goal, const PathStep *steps, int length)
+{
+    if (length > PATH_CACHE_MAX_LEN)
+        return;
+    unsigned int slots[2] = {((unsigned int)start * 2654435761u ^ (unsigned int)goal) % PATH_CACHE_SLOTS,
+                             (unsigned int)goal % PATH_CACHE_SLOTS};
+    for (unsigned int slot : slots)
+    {
+        PathCacheEntry &e = pf.cache[slot];
+        e.version = version;
+        e.start = start;
+        e.goal = goal;
+        e.length = length;
+        memcpy(e.steps, steps, length * sizeof(PathStep));
+    }
+}
+
+// Finds a shortest 4-connected path from (sx, sy) to (gx, gy). The steps
+// written to `out` exclude the start and include the goal. Returns the number
+// of steps (0 if already there) or -1 if the goal can't be reached or the
+// path doesn't fit in maxSteps; nothing is written to `out` then. Paths from
+// the cache follow the same rules as ones just searched for.
+int findPath(Pathfinder &pf, const CollisionMap &c, int sx, int sy, int gx, int gy, PathStep *out, int maxSteps)
+{
+    pf.queries++;
+    if (!isWalkable(c, gx, gy) || sx < 0 || sx >= WIDTH || sy < 0 || sy >= HEIGHT)
+        return -1;
+
+    int start = sy * WIDTH + sx;
+    int goal = gy * WIDTH + gx;
+    if (start == goal)
+        return 0;
+
+    int cached;
+    if (lookupCachedPath(pf, c.version, start, goal, out, maxSteps, cached))
+    {
+        pf.cache_hits++;
+        return cached;
+    }
+
+    if (++pf.search_id == 0)
+    {
+        // Stamp wrapped; clear old stamps so they can't be mistaken for current.
+        memset(pf.nodes, 0, sizeof(pf.nodes));
+        memset(pf.bucket_search, 0, sizeof(pf.bucket_search));
+        pf.search_id = 1;
+    }
+
+    PathNode &s = pf.nodes[start];
+    s.search = pf.search_id;
+    s.g = 0;
+    s.parent = -1;
+    s.closed = false;
+    int lowest = pathHeuristic(start, gx, gy);
+    openListPush(pf, start, lowest);
+    int openCount = 1;
+
+    static const int dx[4] = {1, -1, 0, 0};
+    static const int dy[4] = {0, 0, 1, -1};
+    bool found = false;
+
+    while (openCount > 0 && lowest <= PATH_MAX_F)
+    {
+        int current = bucketHead(pf, lowest);
+        if (current < 0)
+        {
+            lowest++;
+            continue;
+        }
+        openListRemove(pf, current, lowest);
+        openCount--;
+        PathNode &cur = pf.nodes[current];
+        cur.closed = true;
+        if (current == goal)
+        {
+            found = true;
+            break;
+        }
+
+        int cx = current % WIDTH, cy = current / WIDTH;
+        for (int d = 0; d < 4; d++)
+        {
+            int nx = cx + dx[d], ny = cy + dy[d];
+            if (!isWalkable(c, nx, ny))
+                continue;
+            int ni = ny * WIDTH + nx;
+            PathNode &n = pf.nodes[ni];
+            int g = cur.g + 1;
+            int h = pathHeuristic(ni, gx, gy);
+
+            if (n.search != pf.search_id)
+            {
+                n.search = pf.search_id;
+                n.closed = false;
+                openCount++;
+            }
+            else if (n.closed || g >= n.g)
+            {
+                continue;
+            }
+            else
+            {
+                openListRemove(pf, ni, n.g + h); // Found a cheaper way; move it to its new bucket
+            }
+            n.g = g;
+            n.parent = current;
+            openListPush(pf, ni, g + h);
+            if (g + h < lowest)
+                lowest = g + h;
+        }
+    }
+
+    if (!found)
+        return -1;
+
+    int length = pf.nodes[goal].g;
+    if (length > maxSteps)
+        return -1;
+    int i = length;
+    for (int at = goal; at != start; at = pf.nodes[at].parent)
+    {
+        --i;
+        out[i].x = (int16_t)(at % WIDTH);
+        out[i].y = (int16_t)(at / WIDTH);
+    }
+    storeCachedPath(pf, c.version, start, goal, out, length);
+    return length;
+}
+
+// Convenience for callers that only need the next step toward a goal.
+bool nextStepToward(Pathfinder &pf, const CollisionMap &c, int sx, int sy, int gx, int gy, int &nx, int &ny)
+{
+    int length = findPath(pf, c, sx, sy, gx, gy, pf.steps, PATH_NODES);
+    if (length <= 0)
+        return false;
+    nx = pf.steps[0].x;
+    ny = pf.steps[0].y;
+    return true;
+}
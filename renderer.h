@@ -0,0 +1,452 @@
+#pragma once
+#include "cast.h"
+#include "consoleGameEngine.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Frame output encoder.
+// The renderer remembers what is on the terminal (`front`) and, for each new
+// frame, only sends the cells that changed. Getting the cursor to the next
+// changed cell can be done several ways and the cheapest in bytes is chosen:
+//   - absolute move      ESC[row;colH
+//   - relative moves     ESC[nA / ESC[nB / ESC[nC / ESC[nD
+//   - carriage return    \r, and newline \n for "next row, column 0"
+//   - rewriting the cells in between (cheap for short gaps)
+// Runs of one glyph are sent as the glyph plus ESC[nb (REP) when the
+// terminal supports it and it is shorter. Everything for a frame is built in
+// one buffer and written with a single call.
+// Frames are always WIDTH x SCREEN_HEIGHT; when the terminal is a different
+// size the renderer shows a window (view) of the frame, centred on a larger
+// terminal or clipped to a smaller one and kept around the player. When the
+// view pans, what is already on the terminal is scrolled along with it (see
+// scrollFront()), so a step of the camera costs the row or column it
+// uncovers rather than a whole screen.
+const int SCREEN_HEIGHT = HEIGHT + 1; // The map plus a status line
+const int RENDER_BUFFER_SIZE = 64 * 1024;
+
+// What the terminal understands. Costs are derived from the byte length of
+// the sequences themselves, so this only needs to say what is available.
+struct TerminalCaps
+{
+    bool has_rep;         // CSI n b, repeat previous character
+    bool newline_returns; // '\n' also returns to column 0 (ONLCR, or conhost default)
+    bool has_scroll;      // Scroll regions (DECSTBM) with SU/SD, and ICH/DCH
+};
+
+// Windows consoles with VT processing scroll but don't reliably support REP.
+// Elsewhere TERM decides: the Linux console and the vt* terminals have no
+// REP or SU/SD, and a missing or dumb TERM promises nothing beyond cursor
+// moves. --no-scroll turns scrolling off for terminals that get it wrong.
+TerminalCaps detectTerminalCaps()
+{
+#if defined(_WIN32) || defined(_WIN64)
+    return {false, true, true};
+#else
+    const char *term = getenv("TERM");
+    bool modern = term && *term && strcmp(term, "dumb") != 0 && strcmp(term, "linux") != 0 && strncmp(term, "vt", 2) != 0;
+    return {modern, true, modern};
+#endif
+}
+
+struct Renderer
+{
+    char front[SCREEN_HEIGHT][WIDTH]; // What we believe the terminal shows
+    bool front_valid = false;
+    int cursor_x = 0;
+    int cursor_y = 0;
+    bool cursor_known = false;
+    TerminalCaps caps = detectTerminalCaps();
+    char out[RENDER_BUFFER_SIZE];
+    int out_size = 0;
+    unsigned int last_frame_bytes = 0;
+
+    int term_w = WIDTH; // Terminal size in cells
+    int term_h = SCREEN_HEIGHT;
+    int view_x = 0; // Part of the frame that is shown
+    int view_y = 0;
+    int view_w = WIDTH;
+    int view_h = SCREEN_HEIGHT;
+    int origin_x = 0; // Where the view's top-left cell is on the terminal
+    int origin_y = 0;
+    int pan_x = 0; // How far the view has moved since the terminal was last updated
+    int pan_y = 0;
+    bool clear_pending = false; // Blank the terminal before the next frame
+};
+
+Renderer renderer;
+
+// Call after anything else has written to the console (menus, scenes,
+// clearConsole()) so the next frame is sent in full.
+void invalidateScreen(Renderer &r)
+{
+    r.front_valid = false;
+    r.cursor_known = false;
+    r.pan_x = 0;
+    r.pan_y = 0;
+}
+
+// Fits the view to a terminal of cols x rows. The next frame clears the
+// screen and is sent in full, once.
+void resizeRenderer(Renderer &r, int cols, int rows)
+{
+    if (cols < 1 || rows < 1)
+        return;
+    r.term_w = cols;
+    r.term_h = rows;
+    r.view_w = cols < WIDTH ? cols : WIDTH;
+    r.view_h = rows < SCREEN_HEIGHT ? rows : SCREEN_HEIGHT;
+    r.origin_x = cols > WIDTH ? (cols - WIDTH) / 2 : 0;
+    r.origin_y = rows > SCREEN_HEIGHT ? (rows - SCREEN_HEIGHT) / 2 : 0;
+    r.view_x = std::min(r.view_x, WIDTH - r.view_w);
+    r.view_y = std::min(r.view_y, SCREEN_HEIGHT - r.view_h);
+    r.clear_pending = true;
+    invalidateScreen(r);
+    castResize(castRecorder, cols, rows);
+}
+
+// When the view is clipped, keeps (x, y) at least a quarter of the view
+// away from its edges, moving the view by as little as that takes. The
+// terminal is scrolled to match when the next frame is sent.
+void followViewport(Renderer &r, int x, int y)
+{
+    int mx = r.view_w / 4, my = r.view_h / 4;
+    int vx = std::clamp(r.view_x, x - r.view_w + mx + 1, x - mx);
+    int vy = std::clamp(r.view_y, y - r.view_h + my + 1, y - my);
+    vx = std::clamp(vx, 0, WIDTH - r.view_w);
+    vy = std::clamp(vy, 0, SCREEN_HEIGHT - r.view_h);
+    if (vx != r.view_x || vy != r.view_y)
+    {
+        r.pan_x += vx - r.view_x;
+        r.pan_y += vy - r.view_y;
+        r.view_x = vx;
+        r.view_y = vy;
+    }
+}
+
+// Applies a settled terminal resize. Returns true if the view changed, so
+// screens that aren't redrawn every frame (menus) know to present again.
+bool handleConsoleResize(Renderer &r)
+{
+    ConsoleSize size;
+    if (!pollConsoleResize(size))
+        return false;
+    resizeRenderer(r, size.cols, size.rows);
+    return true;
+}
+
+int decimalDigits(int n)
+{
+    int d = 1;
+    while (n >= 10)
+    {
+        n /= 10;
+        d++;
+    }
+    return d;
+}
+
+void emitBytes(Renderer &r, const char *s, int n)
+{
+    memcpy(r.out + r.out_size, s, n);
+    r.out_size += n;
+}
+
+void emitNumber(Renderer &r, int n)
+{
+    char digits[12];
+    int len = 0;
+    do
+    {
+        digits[len++] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n > 0);
+    while (len > 0)
+        r.out[r.out_size++] = digits[--len];
+}
+
+// ESC [ n <final>, with n omitted when it is 1.
+void emitCsi(Renderer &r, int n, char final)
+{
+    r.out[r.out_size++] = '\033';
+    r.out[r.out_size++] = '[';
+    if (n != 1)
+        emitNumber(r, n);
+    r.out[r.out_size++] = final;
+}
+
+int csiCost(int n)
+{
+    return 3 + (n != 1 ? decimalDigits(n) : 0);
+}
+
+// Frame coordinates to 1-based terminal coordinates.
+int screenColumn(const Renderer &r, int x)
+{
+    return x - r.view_x + r.origin_x + 1;
+}
+
+int screenRow(const Renderer &r, int y)
+{
+    return y - r.view_y + r.origin_y + 1;
+}
+
+int absoluteMoveCost(const Renderer &r, int x, int y)
+{
+    return 4 + decimalDigits(screenRow(r, y)) + decimalDigits(screenColumn(r, x));
+}
+
+// Cheapest way to go right from column `from` to `to` on the row we're on:
+// rewrite the cells in between, or a relative move.
+int horizontalCost(int from, int to)
+{
+    if (to == from)
+        return 0;
+    if (to > from)
+    {
+        int rewrite = to - from;
+        int cuf = csiCost(to - from);
+        return rewrite < cuf ? rewrite : cuf;
+    }
+    return csiCost(from - to);
+}
+
+void emitHorizontal(Renderer &r, const char *row, int from, int to)
+{
+    if (to == from)
+        return;
+    if (to > from)
+    {
+        if (to - from <= csiCost(to - from))
+            emitBytes(r, row + from, to - from);
+        else
+            emitCsi(r, to - from, 'C');
+    }
+    else
+    {
+        emitCsi(r, from - to, 'D');
+    }
+}
+
+// Moves the cursor to (x, y), where `row` is the new content of row y
+// (used when rewriting cells is the cheapest way across).
+void moveCursor(Renderer &r, const char *row, int x, int y)
+{
+    if (r.cursor_known && r.cursor_x == x && r.cursor_y == y)
+        return;
+
+    enum { ABSOLUTE, SAME_ROW, CARRIAGE_RETURN, NEWLINES, VERTICAL } best = ABSOLUTE;
+    int bestCost = absoluteMoveCost(r, x, y);
+    // Column 0 of the terminal is frame column `left`. '\r' and '\n' only
+    // help when that column is part of the view.
+    int left = r.view_x - r.origin_x;
+    bool canReturn = r.origin_x == 0;
+
+    if (r.cursor_known)
+    {
+        int cx = r.cursor_x, cy = r.cursor_y;
+        if (cy == y)
+        {
+            int c = horizontalCost(cx, x);
+            if (c < bestCost)
+                best = SAME_ROW, bestCost = c;
+            c = 1 + horizontalCost(left, x);
+            if (canReturn && c < bestCost)
+                best = CARRIAGE_RETURN, bestCost = c;
+        }
+        else
+        {
+            if (y > cy && r.caps.newline_returns && canReturn)
+            {
+                int c = (y - cy) + horizontalCost(left, x);
+                if (c < bestCost)
+                    best = NEWLINES, bestCost = c;
+            }
+            int c = csiCost(y > cy ? y - cy : cy - y) + horizontalCost(cx, x);
+            if (c < bestCost)
+                best = VERTICAL, bestCost = c;
+        }
+    }
+
+    switch (best)
+    {
+    case ABSOLUTE:
+        r.out[r.out_size++] = '\033';
+        r.out[r.out_size++] = '[';
+        emitNumber(r, screenRow(r, y));
+        r.out[r.out_size++] = ';';
+        emitNumber(r, screenColumn(r, x));
+        r.out[r.out_size++] = 'H';
+        break;
+    case SAME_ROW:
+        emitHorizontal(r, row, r.cursor_x, x);
+        break;
+    case CARRIAGE_RETURN:
+        r.out[r.out_size++] = '\r';
+        emitHorizontal(r, row, left, x);
+        break;
+    case NEWLINES:
+        for (int i = r.cursor_y; i < y; i++)
+            r.out[r.out_size++] = '\n';
+        emitHorizontal(r, row, left, x);
+        break;
+    case VERTICAL:
+        emitCsi(r, y > r.cursor_y ? y - r.cursor_y : r.cursor_y - y, y > r.cursor_y ? 'B' : 'A');
+        emitHorizontal(r, row, r.cursor_x, x);
+        break;
+    }
+    r.cursor_x = x;
+    r.cursor_y = y;
+    r.cursor_known = true;
+}
+
+// Writes row[x0, x1) at the cursor, folding runs of one glyph into REP.
+void emitCells(Renderer &r, const char *row, int x0, int x1)
+{
+    int x = x0;
+    while (x < x1)
+    {
+        char c = row[x];
+        int run = 1;
+        while (x + run < x1 && row[x + run] == c)
+            run++;
+        r.out[r.out_size++] = c;
+        if (r.caps.has_rep && run > 1 && csiCost(run - 1) < run - 1)
+        {
+            emitCsi(r, run - 1, 'b');
+        }
+        else
+        {
+            for (int i = 1; i < run; i++)
+                r.out[r.out_size++] = c;
+        }
+        x += run;
+    }
+}
+
+void flushRenderer(Renderer &r)
+{
+    if (r.out_size > 0)
+    {
+        GameConsole::write(r.out, r.out_size);
+        if (castMissedOutput(castRecorder))
+        {
+            invalidateScreen(r); // The recording missed this frame; resend everything next time
+        }
+    }
+    r.last_frame_bytes = r.out_size;
+    r.out_size = 0;
+}
+
+// Moves what is on the terminal along with a view that has panned by
+// (r.pan_x, r.pan_y), so only the cells it uncovers need sending. Rows are
+// scrolled inside a scroll region covering the view (DECSTBM, then SU or
+// SD); columns are shifted on each row by deleting or inserting characters
+// at its left edge (DCH or ICH), which is only right when the view spans the
+// whole terminal width, as it does whenever it is clipped sideways. `front`
+// is indexed by frame position, so the cells that stay in view are still
+// right as they are and the uncovered ones are now blank. Returns false if
+// the terminal can't be scrolled this way; the frame is then sent in full.
+bool scrollFront(Renderer &r)
+{
+    int dx = r.pan_x, dy = r.pan_y;
+    r.pan_x = 0;
+    r.pan_y = 0;
+    if (!r.caps.has_scroll || abs(dx) >= r.view_w || abs(dy) >= r.view_h ||
+        (dx != 0 && (r.origin_x != 0 || r.view_w != r.term_w)))
+        return false;
+
+    // The cursor hasn't moved on the terminal, but the view has moved under it.
+    r.cursor_x += dx;
+    r.cursor_y += dy;
+
+    const int x0 = r.view_x, x1 = r.view_x + r.view_w;
+    const int y0 = r.view_y, y1 = r.view_y + r.view_h;
+    if (dy != 0)
+    {
+        int n = abs(dy);
+        r.out[r.out_size++] = '\033';
+        r.out[r.out_size++] = '[';
+        emitNumber(r, screenRow(r, y0));
+        r.out[r.out_size++] = ';';
+        emitNumber(r, screenRow(r, y1 - 1));
+        r.out[r.out_size++] = 'r';
+        emitCsi(r, n, dy > 0 ? 'S' : 'T');
+        emitBytes(r, "\033[r", 3); // Back to the whole screen; this also homes the cursor
+        r.cursor_known = false;
+        int uncovered = dy > 0 ? y1 - n : y0;
+        for (int y = uncovered; y < uncovered + n; y++)
+            memset(r.front[y] + x0, ' ', x1 - x0);
+    }
+    if (dx != 0)
+    {
+        int n = abs(dx);
+        int uncovered = dx > 0 ? x1 - n : x0;
+        for (int y = y0; y < y1; y++)
+        {
+            moveCursor(r, r.front[y], x0, y);
+            emitCsi(r, n, dx > 0 ? 'P' : '@');
+            memset(r.front[y] + uncovered, ' ', n);
+        }
+    }
+    return true;
+}
+
+// Encodes the difference between `frame` and what is on screen into r.out.
+void encodeFrame(Renderer &r, const char frame[SCREEN_HEIGHT][WIDTH])
+{
+    r.out_size = 0;
+    if (r.clear_pending)
+    {
+        emitBytes(r, "\033[2J", 4);
+        r.cursor_known = false;
+        r.clear_pending = false;
+    }
+    if ((r.pan_x != 0 || r.pan_y != 0) && (!r.front_valid || !scrollFront(r)))
+    {
+        invalidateScreen(r);
+    }
+
+    const int x0 = r.view_x, x1 = r.view_x + r.view_w;
+    for (int y = r.view_y; y < r.view_y + r.view_h; y++)
+    {
+        const char *row = frame[y];
+        char *shown = r.front[y];
+        if (r.front_valid && memcmp(row + x0, shown + x0, x1 - x0) == 0)
+            continue;
+
+        int x = x0;
+        while (x < x1)
+        {
+            if (r.front_valid && row[x] == shown[x])
+            {
+                x++;
+                continue;
+            }
+            int end = x + 1;
+            while (end < x1 && !(r.front_valid && row[end] == shown[end]))
+                end++;
+
+            moveCursor(r, row, x, y);
+            emitCells(r, row, x, end);
+            r.cursor_x = end;
+            if (screenColumn(r, end) > r.term_w)
+            {
+                // The cursor is parked in the terminal's pending-wrap state;
+                // don't rely on where it is.
+                r.cursor_known = false;
+            }
+            x = end;
+        }
+        memcpy(shown + x0, row + x0, x1 - x0);
+    }
+    r.front_valid = true;
+}
+
+// Sends the difference between `frame` and what is on screen.
+void presentFrame(Renderer &r, const char frame[SCREEN_HEIGHT][WIDTH])
+{
+    encodeFrame(r, frame);
+    flushRenderer(r);
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include "snapshots.h"
+#include <cstdint>
+#include <cstdio>
+
+// Deterministic session recording.
+// A recording is the RNG seed plus every key press tagged with the game tick
+// it was read on. Since the simulation only advances once per tick and all
+// randomness comes from nextRandom(), feeding the same keys on the same ticks
+// reproduces the session exactly. A hash of the game state is written every
+// REPLAY_HASH_INTERVAL ticks so a replay can tell where it started to diverge.
+//
+// File layout (little endian):
+//   header : magic u32, version u16, snapshot version u16, seed u32, map seed u32
+//   record : type u8, tick delta varint, payload
+//            REC_KEY  -> key u8
+//            REC_HASH -> state hash u64
+//            REC_END  -> (none)
+const uint32_t REPLAY_MAGIC = 0x50524B52; // "RKRP"
+const uint16_t REPLAY_VERSION = 2;
+const unsigned int REPLAY_HASH_INTERVAL = 64;
+
+enum ReplayRecordType : uint8_t
+{
+    REC_KEY = 1,
+    REC_HASH = 2,
+    REC_END = 3
+};
+
+struct ReplayRecord
+{
+    uint8_t type;
+    unsigned int tick;
+    int key;
+    uint64_t hash;
+};
+
+// FNV-1a over the whole snapshot. Snapshots are already captured every tick
+// for the rewind history, so hashing reuses that instead of walking globals.
+uint64_t hashSnapshot(const GameSnapshot &snap)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(&snap);
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(GameSnapshot); ++i)
+    {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// ------------------------------- RECORDING ----------------------------------------------------
+struct ReplayWriter
+{
+    FILE *file = nullptr;
+    unsigned int last_tick = 0;
+};
+
+void writeVarint(FILE *f, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        fputc((int)(v & 0x7F) | 0x80, f);
+        v >>= 7;
+    }
+    fputc((int)v, f);
+}
+
+bool openReplayWriter(ReplayWriter &w, const char *path, uint32_t seed, uint32_t map_seed)
+{
+    w.file = fopen(path, "wb");
+    if (!w.file)
+        return false;
+    uint16_t snapshot_version = SNAPSHOT_VERSION;
+    fwrite(&REPLAY_MAGIC, 4, 1, w.file);
+    fwrite(&REPLAY_VERSION, 2, 1, w.file);
+    fwrite(&snapshot_version, 2, 1, w.file);
+    fwrite(&seed, 4, 1, w.file);
+    fwrite(&map_seed, 4, 1, w.file);
+    w.last_tick = 0;
+    return true;
+}
+
+void writeReplayRecord(ReplayWriter &w, uint8_t type, unsigned int tick)
+{
+    fputc(type, w.file);
+    writeVarint(w.file, tick - w.last_tick);
+    w.last_tick = tick;
+}
+
+void recordKey(ReplayWriter &w, unsigned int tick, int key)
+{
+    if (!w.file)
+        return;
+    writeReplayRecord(w, REC_KEY, tick);
+    fputc(key & 0xFF, w.file);
+}
+
+void recordHash(ReplayWriter &w, unsigned int tick, uint64_t hash)
+{
+    if (!w.file)
+        return;
+    writeReplayRecord(w, REC_HASH, tick);
+    fwrite(&hash, 8, 1, w.file);
+    fflush(w.file); // Keep the file usable even if the game is killed
+}
+
+void closeReplayWriter(ReplayWriter &w, unsigned int tick)
+{
+    if (!w.file)
+        return;
+    writeReplayRecord(w, REC_END, tick);
+    fclose(w.file);
+    w.file = nullptr;
+}
+
+// ------------------------------- PLAYBACK -----------------------------------------------------
+struct ReplayReader
+{
+    FILE *file = nullptr;
+    uint32_t seed = 0;
+    uint32_t map_seed = 0;
+    unsigned int tick = 0;
+};
+
+bool readVarint(FILE *f, uint32_t &v)
+{
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        int c = fgetc(f);
+        if (c == EOF)
+            return false;
+        v |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool openReplayReader(ReplayReader &r, const char *path)
+{
+    r.file = fopen(path, "rb");
+    if (!r.file)
+        return false;
+    uint32_t magic = 0;
+    uint16_t version = 0, snapshot_version = 0;
+    bool ok = fread(&magic, 4, 1, r.file) == 1 && fread(&version, 2, 1, r.file) == 1 &&
+              fread(&snapshot_version, 2, 1, r.file) == 1 && fread(&r.seed, 4, 1, r.file) == 1 &&
+              fread(&r.map_seed, 4, 1, r.file) == 1;
+    if (!ok || magic != REPLAY_MAGIC || version != REPLAY_VERSION || snapshot_version != SNAPSHOT_VERSION)
+    {
+        fclose(r.file);
+        r.file = nullptr;
+        return false;
+    }
+    r.tick = 0;
+    return true;
+}
+
+// Reads the next record. A truncated file reads as REC_END.
+bool readReplayRecord(ReplayReader &r, ReplayRecord &rec)
+{
+    int type = fgetc(r.file);
+    uint32_t delta = 0;
+    if (type == EOF || !readVarint(r.file, delta))
+    {
+        rec.type = REC_END;
+        rec.tick = r.tick;
+        return false;
+    }
+    r.tick += delta;
+    rec.type = (uint8_t)type;
+    rec.tick = r.tick;
+
+    if (type == REC_KEY)
+    {
+        int c = fgetc(r.file);
+        rec.key = c == EOF ? 0 : c;
+    }
+    else if (type == REC_HASH)
+    {
+        if (fread(&rec.hash, 8, 1, r.file) != 1)
+            rec.type = REC_END;
+    }
+    return rec.type != REC_END;
+}
+
+void closeReplayReader(ReplayReader &r)
+{
+    if (r.file)
+        fclose(r.file);
+    r.file = nullptr;
+}
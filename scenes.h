@@ -1,25 +1,42 @@
 #pragma once
 #include "consoleGameEngine.h"
-#include <iostream>
-#include <string>
 
 class Scene
 {
-    std::string frame;
-    std::string text;
+    // Scenes are built from string literals, so they point at them rather
+    // than keeping copies.
+    const char *frame;
+    const char *text;
 
 private:
 public:
-    Scene(std::string f, std::string t)
+    Scene(const char *f, const char *t)
     {
         frame = f;
         text = t;
     }
     void play()
     {
-        system("cls");
-        std::cout << frame << "\n\n"
-                  << text;
+        showFrame();
+        GameConsole::write(text);
+    }
+    // Just the picture, leaving the cursor where the text goes.
+    void showFrame()
+    {
+        clearConsole();
+        GameConsole::write(frame);
+        GameConsole::write("\n\n", 2);
+    }
+    const char *caption() const
+    {
+        return text;
+    }
+    int frameRows() const
+    {
+        int rows = 1;
+        for (const char *c = frame; *c; c++)
+            rows += *c == '\n';
+        return rows;
     }
 };
 
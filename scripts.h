@@ -0,0 +1,351 @@
+#pragma once
+#include "timers.h"
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+
+// Scripted sequences as C++20 coroutines. A script is written top to bottom
+// like blocking code,
+//     co_await wait(s, 500);
+//     int key = co_await keypress(s);
+//     co_await move_to(s, rocky, 40, 12);
+// but each co_await suspends it and hands control back to the caller, and
+// runScripts() resumes it when what it waits for has happened. Waits sit in
+// a timer wheel, key and movement waits in flat lists, so a tick costs
+// nothing for sleeping scripts and nothing blocks the loop.
+// Coroutine frames come from a fixed pool of blocks rather than the heap;
+// a script whose frame doesn't fit, or started when the pool is full,
+// simply doesn't start. Scripts are for presentation (cinematics, UI): they
+// can't be saved in snapshots, so they must not change game state.
+const int SCRIPT_SLOTS = 4096;      // Scripts that can be running at once
+const int SCRIPT_FRAME_BYTES = 256; // Largest coroutine frame the pool takes
+const int SCRIPT_TIMERS = SCRIPT_SLOTS; // One pending wake-up per script at most
+
+// ------------------------------- FRAME POOL --------------------------------------------------
+struct ScriptFramePool
+{
+    alignas(std::max_align_t) unsigned char blocks[SCRIPT_SLOTS][SCRIPT_FRAME_BYTES];
+    int16_t next_free[SCRIPT_SLOTS];
+    int free_head = -1;
+    int in_use = 0;
+    bool initialized = false;
+};
+
+ScriptFramePool scriptFrames;
+
+void *allocScriptFrame(std::size_t size)
+{
+    ScriptFramePool &p = scriptFrames;
+    if (!p.initialized)
+    {
+        for (int i = 0; i < SCRIPT_SLOTS; i++)
+            p.next_free[i] = (int16_t)(i + 1 < SCRIPT_SLOTS ? i + 1 : -1);
+        p.free_head = 0;
+        p.initialized = true;
+    }
+    if (size > SCRIPT_FRAME_BYTES || p.free_head < 0)
+        return nullptr;
+    int i = p.free_head;
+    p.free_head = p.next_free[i];
+    p.in_use++;
+    return p.blocks[i];
+}
+
+void freeScriptFrame(void *frame)
+{
+    ScriptFramePool &p = scriptFrames;
+    int i = (int)((static_cast<unsigned char *>(frame) - &p.blocks[0][0]) / SCRIPT_FRAME_BYTES);
+    p.next_free[i] = (int16_t)p.free_head;
+    p.free_head = i;
+    p.in_use--;
+}
+
+// ------------------------------- SCHEDULER ---------------------------------------------------
+struct ScriptScheduler;
+
+struct Script
+{
+    struct promise_type
+    {
+        ScriptScheduler *scheduler = nullptr;
+        int slot = -1;
+
+        Script get_return_object() { return Script{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        static Script get_return_object_on_allocation_failure() { return Script{}; }
+        std::suspend_always initial_suspend() noexcept { return {}; } // Runs once started
+        std::suspend_never final_suspend() noexcept { return {}; }    // The frame frees itself when done
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void *operator new(std::size_t size) noexcept { return allocScriptFrame(size); }
+        static void operator delete(void *frame) noexcept { freeScriptFrame(frame); }
+
+        ~promise_type();
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Something a script can walk around: a position and a pace.
+struct ScriptActor
+{
+    int x = 0;
+    int y = 0;
+    int step_ms = 50; // Time per cell
+};
+
+enum ScriptWaitKind : uint8_t
+{
+    SCRIPT_RUNNING,
+    SCRIPT_WAIT_TIME,
+    SCRIPT_WAIT_KEY,
+    SCRIPT_WAIT_MOVE,
+};
+
+struct ScriptSlot
+{
+    std::coroutine_handle<Script::promise_type> handle;
+    uint16_t generation = 0; // Bumped every time a script starts in the slot
+    ScriptWaitKind wait = SCRIPT_RUNNING;
+    TimerId timer = 0;   // SCRIPT_WAIT_TIME and SCRIPT_WAIT_MOVE: next wake-up
+    int list_pos = -1;   // SCRIPT_WAIT_KEY: index in key_waiters
+    int key = 0;         // The key that woke it
+    ScriptActor *actor = nullptr; // SCRIPT_WAIT_MOVE
+    int target_x = 0;
+    int target_y = 0;
+};
+
+enum ScriptTimerKind : uint16_t
+{
+    SCRIPT_TIMER_WAKE, // Resume the script
+    SCRIPT_TIMER_STEP, // Move the script's actor one cell
+};
+
+struct ScriptScheduler
+{
+    int tick_ms = 10; // Real time per runScripts() call
+    TimerWheel<SCRIPT_TIMERS> timers;
+    ScriptSlot slots[SCRIPT_SLOTS];
+    int16_t next_free[SCRIPT_SLOTS];
+    int free_head = -1;
+    int running = 0;
+    int16_t key_waiters[SCRIPT_SLOTS];
+    int key_waiter_count = 0;
+};
+
+void resetScriptScheduler(ScriptScheduler &s, int tickMs)
+{
+    s.tick_ms = tickMs;
+    resetTimers(s.timers);
+    for (int i = 0; i < SCRIPT_SLOTS; i++)
+    {
+        s.slots[i] = ScriptSlot{};
+        s.next_free[i] = (int16_t)(i + 1 < SCRIPT_SLOTS ? i + 1 : -1);
+    }
+    s.free_head = 0;
+    s.running = 0;
+    s.key_waiter_count = 0;
+}
+
+uint32_t scriptTicks(const ScriptScheduler &s, int ms)
+{
+    return (uint32_t)((ms + s.tick_ms - 1) / s.tick_ms);
+}
+
+// Takes a script out of whatever it is waiting on.
+void stopWaiting(ScriptScheduler &s, int slot)
+{
+    ScriptSlot &w = s.slots[slot];
+    if (w.wait == SCRIPT_WAIT_TIME || w.wait == SCRIPT_WAIT_MOVE)
+    {
+        cancelTimer(s.timers, w.timer);
+    }
+    else if (w.wait == SCRIPT_WAIT_KEY)
+    {
+        int last = s.key_waiters[--s.key_waiter_count];
+        s.key_waiters[w.list_pos] = (int16_t)last;
+        s.slots[last].list_pos = w.list_pos;
+    }
+    w.wait = SCRIPT_RUNNING;
+}
+
+Script::promise_type::~promise_type()
+{
+    if (!scheduler)
+        return;
+    ScriptScheduler &s = *scheduler;
+    stopWaiting(s, slot);
+    s.slots[slot].handle = nullptr;
+    s.next_free[slot] = (int16_t)s.free_head;
+    s.free_head = slot;
+    s.running--;
+}
+
+// Starts `script` and runs it up to its first co_await. Returns false if it
+// couldn't be started (no frame or no slot), in which case it never runs.
+bool startScript(ScriptScheduler &s, Script script)
+{
+    if (!script.handle)
+        return false;
+    if (s.free_head < 0)
+    {
+        script.handle.destroy();
+        return false;
+    }
+    int slot = s.free_head;
+    s.free_head = s.next_free[slot];
+    s.running++;
+    uint16_t generation = (uint16_t)(s.slots[slot].generation + 1);
+    s.slots[slot] = ScriptSlot{};
+    s.slots[slot].handle = script.handle;
+    s.slots[slot].generation = generation;
+    script.handle.promise().scheduler = &s;
+    script.handle.promise().slot = slot;
+    script.handle.resume();
+    return true;
+}
+
+void resumeScript(ScriptScheduler &s, int slot)
+{
+    s.slots[slot].wait = SCRIPT_RUNNING;
+    s.slots[slot].handle.resume(); // May finish and free the slot
+}
+
+// Ends every script where it stands.
+void stopScripts(ScriptScheduler &s)
+{
+    for (int i = 0; i < SCRIPT_SLOTS && s.running > 0; i++)
+    {
+        if (s.slots[i].handle)
+            s.slots[i].handle.destroy();
+    }
+}
+
+int signOf(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+// One tick: hands `key` (0 for none) to the scripts waiting for a key press,
+// then wakes the scripts whose wait is over and moves actors a cell along.
+void runScripts(ScriptScheduler &s, int key)
+{
+    if (key != 0)
+    {
+        // Scripts woken here may start waiting for the next key, so only
+        // the ones waiting now are resumed. One resumed earlier may have
+        // ended a later one, and a new script may even have started in its
+        // slot; the generation tells them apart.
+        int count = s.key_waiter_count;
+        int16_t waiting[SCRIPT_SLOTS];
+        uint16_t generations[SCRIPT_SLOTS];
+        for (int i = 0; i < count; i++)
+        {
+            ScriptSlot &w = s.slots[s.key_waiters[i]];
+            waiting[i] = s.key_waiters[i];
+            generations[i] = w.generation;
+            w.wait = SCRIPT_RUNNING;
+            w.key = key;
+        }
+        s.key_waiter_count = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const ScriptSlot &w = s.slots[waiting[i]];
+            if (w.handle && w.generation == generations[i])
+                resumeScript(s, waiting[i]);
+        }
+    }
+
+    advanceTimers(s.timers, [&](const Timer &t)
+    {
+        int slot = t.value;
+        ScriptSlot &w = s.slots[slot];
+        if (t.kind == SCRIPT_TIMER_STEP)
+        {
+            ScriptActor &a = *w.actor;
+            a.x += signOf(w.target_x - a.x);
+            a.y += signOf(w.target_y - a.y);
+            if (a.x != w.target_x || a.y != w.target_y)
+            {
+                w.timer = scheduleTimer(s.timers, scriptTicks(s, a.step_ms), SCRIPT_TIMER_STEP, slot);
+                return;
+            }
+        }
+        resumeScript(s, slot);
+    });
+}
+
+// ------------------------------- AWAITABLES --------------------------------------------------
+// Each remembers the scheduler so a script can be written against any of them.
+struct ScriptAwait
+{
+    ScriptScheduler &s;
+
+    bool await_ready() const noexcept { return false; }
+    void await_resume() const noexcept {}
+};
+
+struct WaitAwait : ScriptAwait
+{
+    int ms;
+
+    void await_suspend(std::coroutine_handle<Script::promise_type> h)
+    {
+        int slot = h.promise().slot;
+        s.slots[slot].wait = SCRIPT_WAIT_TIME;
+        s.slots[slot].timer = scheduleTimer(s.timers, scriptTicks(s, ms), SCRIPT_TIMER_WAKE, slot);
+    }
+};
+
+struct KeyAwait : ScriptAwait
+{
+    int slot = -1;
+
+    void await_suspend(std::coroutine_handle<Script::promise_type> h)
+    {
+        slot = h.promise().slot;
+        s.slots[slot].wait = SCRIPT_WAIT_KEY;
+        s.slots[slot].list_pos = s.key_waiter_count;
+        s.key_waiters[s.key_waiter_count++] = (int16_t)slot;
+    }
+    int await_resume() const noexcept { return s.slots[slot].key; }
+};
+
+struct MoveAwait : ScriptAwait
+{
+    ScriptActor &actor;
+    int x;
+    int y;
+
+    bool await_ready() const noexcept { return actor.x == x && actor.y == y; }
+    void await_suspend(std::coroutine_handle<Script::promise_type> h)
+    {
+        int slot = h.promise().slot;
+        ScriptSlot &w = s.slots[slot];
+        w.wait = SCRIPT_WAIT_MOVE;
+        w.actor = &actor;
+        w.target_x = x;
+        w.target_y = y;
+        w.timer = scheduleTimer(s.timers, scriptTicks(s, actor.step_ms), SCRIPT_TIMER_STEP, slot);
+    }
+};
+
+// Resumes after `ms` milliseconds.
+WaitAwait wait(ScriptScheduler &s, int ms)
+{
+    return WaitAwait{{s}, ms};
+}
+
+// Resumes with the next key pressed.
+KeyAwait keypress(ScriptScheduler &s)
+{
+    return KeyAwait{{s}};
+}
+
+// Walks `actor` one cell at a time (diagonals allowed) to (x, y) and resumes
+// when it gets there.
+MoveAwait move_to(ScriptScheduler &s, ScriptActor &actor, int x, int y)
+{
+    return MoveAwait{{s}, actor, x, y};
+}
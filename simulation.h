@@ -0,0 +1,376 @@
+#pragma once
+#include "consoleGameEngine.h"
+#include "ailod.h"
+#include "combat.h"
+#include "gamestate.h"
+#include "levels.h"
+#include "mechanics.h"
+#include "pathfinding.h"
+#include "snapshots.h"
+#include "telemetry.h"
+#include "timers.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+// The rules of the game, as functions of the GameState they run on: starting
+// a game, moving between worlds, the player's keys, the enemies and the fixed
+// tick that drives it all, plus saving to and restoring from snapshots.
+// Nothing here draws or touches presentation; the live game watches
+// GameState::worlds_entered to know when to reset the fog, the title card
+// and so on.
+const int KEY_SELECT_WORLD = 0xF0; // + world index. Sent by the level-select menu and recorded like a key press
+
+enum GameTimerKind : uint16_t
+{
+    TIMER_ENEMY_MOVE,    // Periodic: every enemy takes a step
+    TIMER_STINGER_READY, // One-shot: the stinger can be thrown again
+};
+
+bool stepEnemy(GameState &g, int i, AiLodLevel level, int &paths);
+
+// World `index`, from the preloaded set if the game has one, otherwise from
+// the streamer (waiting for it if it isn't loaded yet).
+const LoadedWorld &fetchWorld(GameState &g, int index)
+{
+    if (g.worlds)
+        return g.worlds[index];
+    return takeWorld(*g.streamer, index, g.map_seed);
+}
+
+void prefetchWorld(GameState &g, int index)
+{
+    if (!g.worlds)
+        preloadWorld(*g.streamer, index, g.map_seed);
+}
+
+void applyWorld(GameState &g, const LoadedWorld &world)
+{
+    memcpy(g.map, world.tiles, sizeof(g.map));
+    memcpy(g.collision.flags, world.collision, sizeof(g.collision.flags));
+    g.collision.version++;
+    for (int i = 0; i < MAX_ENEMIES; ++i)
+    {
+        g.enemies[i] = world.spawns[i];
+        if (g.enemies[i].is_alive)
+        {
+            logEvent(telemetry, TEL_SPAWN, i, g.enemies[i].x, g.enemies[i].y, world.index);
+        }
+    }
+    rebuildEntityGrid(g);
+    resetStingers(g.stingers);
+    g.worlds_entered++;
+}
+
+// Puts the player at the start of world `index`. Only the world after the
+// current one is preloaded; any other (from level select) is loaded on the spot.
+void enterWorld(GameState &g, int index)
+{
+    logEvent(telemetry, TEL_LEVEL, g.current_world, g.player_x, g.player_y, index);
+    g.current_world = index;
+    applyWorld(g, fetchWorld(g, g.current_world));
+    g.player_x = WIDTH / 2;
+    g.player_y = HEIGHT / 2;
+    g.player_caught = false;
+    prefetchWorld(g, g.current_world + 1);
+}
+
+// Called when the player walks off the east edge. The next world has been
+// loading in the background since this one started, so this is normally just
+// a copy of already-built data.
+void advanceWorld(GameState &g)
+{
+    enterWorld(g, g.current_world + 1);
+}
+
+// Sets `g` up for a new game in the first world. The throttle and map seed
+// are kept, so callers set them first.
+void startGame(GameState &g, uint32_t seed)
+{
+    seedRandom(g.rng, seed);
+    g.current_world = 0;
+    applyWorld(g, fetchWorld(g, g.current_world));
+    prefetchWorld(g, g.current_world + 1);
+    g.player_x = WIDTH / 2;
+    g.player_y = HEIGHT / 2;
+    g.player_caught = false;
+    g.facing_x = 1;
+    g.facing_y = 0;
+    g.tick = 0;
+    resetTimers(g.timers);
+    resetAiLod(g.ai_lod);
+    scheduleTimer(g.timers, g.enemy_move_throttle, TIMER_ENEMY_MOVE, 0, g.enemy_move_throttle + 1);
+    g.stinger_timer = 0;
+}
+
+// Movement, attacks and level select. Keys that aren't about the game
+// itself (saving, rewinding, the fog) are up to the caller.
+void handleGameKey(GameState &g, int key)
+{
+    int next_x = g.player_x;
+    int next_y = g.player_y;
+
+    switch (key)
+    {
+    case 'w':
+        next_y = g.player_y - 1;
+        break;
+    case 's':
+        next_y = g.player_y + 1;
+        break;
+    case 'a':
+        next_x = g.player_x - 1;
+        break;
+    case 'd':
+        next_x = g.player_x + 1;
+        break;
+    case ' ':
+        handleAttack(g, g.player_x, g.player_y, g.facing_x, g.facing_y);
+        return;
+    case 'e':
+        if (!findTimer(g.timers, g.stinger_timer) && throwStinger(g.stingers, g.player_x, g.player_y, g.facing_x, g.facing_y))
+        {
+            g.stinger_timer = scheduleTimer(g.timers, STINGER_COOLDOWN_TICKS, TIMER_STINGER_READY);
+        }
+        return;
+    }
+    if (key >= KEY_SELECT_WORLD && key < KEY_SELECT_WORLD + WORLD_COUNT)
+    {
+        enterWorld(g, key - KEY_SELECT_WORLD);
+        return;
+    }
+
+    if (next_x != g.player_x || next_y != g.player_y)
+    {
+        g.facing_x = next_x - g.player_x;
+        g.facing_y = next_y - g.player_y;
+    }
+
+    if (next_x >= 0 && next_x < WIDTH && next_y >= 0 && next_y < HEIGHT)
+    {
+        if (!(g.collision.flags[next_y][next_x] & TILE_BLOCKS_MOVE))
+        {
+            g.player_x = next_x;
+            g.player_y = next_y;
+        }
+    }
+
+    // The east edge leads on to the next world.
+    if (g.player_x == WIDTH - 1 && g.current_world + 1 < WORLD_COUNT)
+    {
+        advanceWorld(g);
+    }
+}
+
+// One enemy move round. Which enemies are updated, and how much path
+// planning they get, is up to their level of detail (ailod.h).
+void UpdateNPCs(GameState &g)
+{
+    bool wasCaught = g.player_caught;
+    AiLodState &lod = g.ai_lod;
+    AiLodLevel level[MAX_ENEMIES];
+    for (int i = 0; i < MAX_ENEMIES; ++i)
+    {
+        level[i] = aiLodLevel(g.enemies[i].x - g.player_x, g.enemies[i].y - g.player_y);
+    }
+    int paths = AI_PATHS_PER_ROUND;
+    int missed = -1; // First patroller the budget ran out on
+    for (int l = AI_LOD_NEAR; l < AI_LOD_LEVELS; ++l)
+    {
+        for (int k = 0; k < MAX_ENEMIES; ++k)
+        {
+            int i = (lod.cursor + k) % MAX_ENEMIES;
+            if (!g.enemies[i].is_alive || level[i] != l || !aiLodDue(lod, i, level[i]))
+                continue;
+            if (!stepEnemy(g, i, level[i], paths) && missed < 0)
+                missed = i;
+        }
+    }
+    if (missed >= 0)
+        lod.cursor = (int16_t)missed;
+    lod.round++;
+
+    // 2. Check for Threat (Collision with Player)
+    // GAME OVER logic goes here! The live game shows the message; the
+    // simulation itself never writes to the screen so games can run headless.
+    int catcher = entityAt(g, g.player_x, g.player_y);
+    g.player_caught = catcher >= 0;
+    if (g.player_caught && !wasCaught)
+    {
+        logEvent(telemetry, TEL_COLLISION, catcher, g.player_x, g.player_y, 0);
+    }
+}
+
+// Whether an enemy may step onto (x, y). Enemies don't stack, so entity_at
+// always names the one enemy on a cell.
+bool canEnemyEnter(const GameState &g, int x, int y)
+{
+    return x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT && !(g.collision.flags[y][x] & TILE_BLOCKS_MOVE) && entityAt(g, x, y) < 0;
+}
+
+// One cell from (x, y) towards (tx, ty), along the axis with further to go.
+void greedyStep(int x, int y, int tx, int ty, int &next_x, int &next_y)
+{
+    next_x = x;
+    next_y = y;
+    if (abs(tx - x) >= abs(ty - y))
+        next_x += (tx > x) - (tx < x);
+    else
+        next_y += (ty > y) - (ty < y);
+}
+
+// Moves enemy i one cell. A patroller near enough to plan with A* takes one
+// of the round's `paths` for it; returns false if there were none left.
+bool stepEnemy(GameState &g, int i, AiLodLevel level, int &paths)
+{
+    NPC &e = g.enemies[i];
+    int next_x = e.x;
+    int next_y = e.y;
+    bool planned = true;
+
+    int dist_x = abs(g.player_x - e.x);
+    int dist_y = abs(g.player_y - e.y);
+    bool patrolling = e.goal_x >= 0 && dist_x + dist_y > PATROL_CHASE_RANGE;
+
+    if (patrolling)
+    {
+        // Walk to the patrol point, then turn around.
+        if (e.x == e.goal_x && e.y == e.goal_y)
+        {
+            std::swap(e.goal_x, e.home_x);
+            std::swap(e.goal_y, e.home_y);
+        }
+        if (level != AI_LOD_FAR && paths > 0)
+        {
+            paths--;
+            nextStepToward(g.paths, g.collision, e.x, e.y, e.goal_x, e.goal_y, next_x, next_y);
+        }
+        else
+        {
+            planned = level == AI_LOD_FAR;
+            greedyStep(e.x, e.y, e.goal_x, e.goal_y, next_x, next_y); // Held below if blocked
+        }
+    }
+    // Simple A.I.: Move one step closer to the player on the x-axis or y-axis.
+    // Diagonal ties are broken randomly so enemies don't all move in lockstep.
+    else if (dist_x > dist_y || (dist_x == dist_y && dist_x != 0 && (nextRandom(g.rng) & 1)))
+    {
+        // Move horizontally
+        next_x += (g.player_x > e.x) ? 1 : -1;
+    }
+    else
+    {
+        // Move vertically
+        next_y += (g.player_y > e.y) ? 1 : -1;
+    }
+
+    // 1. Check for Map Boundaries/Obstacles (collision map is built from IsObstacle)
+    if (canEnemyEnter(g, next_x, next_y))
+    {
+        // Move the enemy
+        moveEntity(g, i, next_x, next_y);
+    }
+    return planned;
+}
+
+void onGameTimer(GameState &g, const Timer &t)
+{
+    switch (t.kind)
+    {
+    case TIMER_ENEMY_MOVE:
+        UpdateNPCs(g);
+        break;
+    case TIMER_STINGER_READY:
+        break; // Nothing to do; the cooldown is over once the timer is gone
+    }
+}
+
+// One fixed step of the simulation: the key pressed on it (0 for none), then
+// timers and stingers. `inspect(const GameState &)` sees the state the tick
+// ends in, before the tick counter moves on.
+template <typename Inspect>
+void simulateTick(GameState &g, int key, Inspect inspect)
+{
+    telemetry_tick = g.tick;
+    if (key != 0)
+    {
+        handleGameKey(g, key);
+    }
+    advanceTimers(g.timers, [&g](const Timer &t)
+                  { onGameTimer(g, t); });
+    updateStingers(g);
+    inspect(static_cast<const GameState &>(g));
+    g.tick++;
+}
+
+// ------------------------------- SNAPSHOTS ---------------------------------------------------
+void captureSnapshot(const GameState &g, GameSnapshot &snap)
+{
+    snap.magic = SNAPSHOT_MAGIC;
+    snap.version = SNAPSHOT_VERSION;
+    snap.enemy_count = MAX_ENEMIES;
+    snap.tick = g.tick;
+    snap.player_x = (int16_t)g.player_x;
+    snap.player_y = (int16_t)g.player_y;
+    snap.current_world = (int16_t)g.current_world;
+    snap.reserved = 0;
+    snap.enemy_move_throttle = g.enemy_move_throttle;
+    snap.facing_x = (int16_t)g.facing_x;
+    snap.facing_y = (int16_t)g.facing_y;
+    snap.stinger_timer = g.stinger_timer;
+    snap.stingers = g.stingers;
+    snap.timers = g.timers;
+    snap.ai_lod = g.ai_lod;
+    for (int i = 0; i < MAX_ENEMIES; ++i)
+    {
+        snap.enemies[i].x = (int16_t)g.enemies[i].x;
+        snap.enemies[i].y = (int16_t)g.enemies[i].y;
+        snap.enemies[i].character = g.enemies[i].character;
+        snap.enemies[i].is_alive = g.enemies[i].is_alive ? 1 : 0;
+        snap.enemies[i].goal_x = (int16_t)g.enemies[i].goal_x;
+        snap.enemies[i].goal_y = (int16_t)g.enemies[i].goal_y;
+        snap.enemies[i].home_x = (int16_t)g.enemies[i].home_x;
+        snap.enemies[i].home_y = (int16_t)g.enemies[i].home_y;
+    }
+    memcpy(snap.map, g.map, sizeof(g.map));
+}
+
+// Returns true if the map changed, i.e. the terrain has to be redrawn.
+bool restoreSnapshot(GameState &g, const GameSnapshot &snap)
+{
+    g.tick = snap.tick;
+    g.player_x = snap.player_x;
+    g.player_y = snap.player_y;
+    if (g.current_world != snap.current_world)
+    {
+        g.current_world = snap.current_world;
+        prefetchWorld(g, g.current_world + 1);
+    }
+    g.enemy_move_throttle = snap.enemy_move_throttle;
+    g.facing_x = snap.facing_x;
+    g.facing_y = snap.facing_y;
+    g.stinger_timer = snap.stinger_timer;
+    g.stingers = snap.stingers;
+    g.timers = snap.timers;
+    g.ai_lod = snap.ai_lod;
+    for (int i = 0; i < MAX_ENEMIES; ++i)
+    {
+        g.enemies[i].x = snap.enemies[i].x;
+        g.enemies[i].y = snap.enemies[i].y;
+        g.enemies[i].character = snap.enemies[i].character;
+        g.enemies[i].is_alive = snap.enemies[i].is_alive != 0;
+        g.enemies[i].goal_x = snap.enemies[i].goal_x;
+        g.enemies[i].goal_y = snap.enemies[i].goal_y;
+        g.enemies[i].home_x = snap.enemies[i].home_x;
+        g.enemies[i].home_y = snap.enemies[i].home_y;
+    }
+    bool mapChanged = memcmp(g.map, snap.map, sizeof(g.map)) != 0;
+    if (mapChanged)
+    {
+        memcpy(g.map, snap.map, sizeof(g.map));
+        buildCollisionMap(g.collision, g.map);
+    }
+    rebuildEntityGrid(g);
+    return mapChanged;
+}
@@ -0,0 +1,269 @@
+#pragma once
+#include "combat.h"
+#include "consoleGameEngine.h"
+#include "gamestate.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Versioned binary snapshot of everything the game loop mutates.
+// Bump SNAPSHOT_VERSION whenever the layout of GameSnapshot changes.
+const uint32_t SNAPSHOT_MAGIC = 0x4B434F52; // "ROCK"
+const uint16_t SNAPSHOT_VERSION = 8;
+
+struct SnapshotNPC
+{
+    int16_t x;
+    int16_t y;
+    char character;
+    uint8_t is_alive;
+    int16_t goal_x;
+    int16_t goal_y;
+    int16_t home_x;
+    int16_t home_y;
+};
+
+struct GameSnapshot
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t enemy_count;
+    uint32_t tick;
+    int16_t player_x;
+    int16_t player_y;
+    int16_t current_world;
+    int16_t reserved;
+    int32_t enemy_move_throttle;
+    int16_t facing_x; // Direction Rocky attacks in
+    int16_t facing_y;
+    uint32_t stinger_timer; // TimerId of the stinger cooldown
+    StingerPool stingers;
+    TimerWheel<GAME_TIMERS> timers;
+    AiLodState ai_lod;
+    SnapshotNPC enemies[MAX_ENEMIES];
+    char map[HEIGHT][WIDTH];
+};
+
+// Rewind history: every pushed snapshot is stored as an XOR delta against the
+// one before it, run-length encoded so that only changed bytes take space.
+// Because XOR is its own inverse, stepping backwards is "current ^= delta".
+// All storage is static so pushing every tick never touches the heap.
+const int SNAPSHOT_RING_SLOTS = 4096;
+const int SNAPSHOT_RING_BYTES = 512 * 1024;
+
+struct SnapshotDelta
+{
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct SnapshotRing
+{
+    GameSnapshot current;                     // Newest state, fully expanded
+    SnapshotDelta deltas[SNAPSHOT_RING_SLOTS];
+    unsigned char bytes[SNAPSHOT_RING_BYTES];
+    unsigned char scratch[2 * sizeof(GameSnapshot)];
+    int oldest = 0;
+    int count = 0;
+    uint32_t write_offset = 0;
+};
+
+SnapshotRing rewindHistory;
+GameSnapshot quickSaveSlot;
+bool hasQuickSave = false;
+
+// Encodes (a XOR b) as a list of [skip:u16][len:u16][len bytes] runs.
+// Runs separated by fewer than 4 unchanged bytes are merged, so the output
+// never exceeds twice the input size.
+uint32_t encodeSnapshotDelta(const GameSnapshot &a, const GameSnapshot &b, unsigned char *out)
+{
+    const unsigned char *pa = reinterpret_cast<const unsigned char *>(&a);
+    const unsigned char *pb = reinterpret_cast<const unsigned char *>(&b);
+    const uint32_t n = sizeof(GameSnapshot);
+    uint32_t written = 0;
+    uint32_t i = 0;
+    uint32_t last_end = 0;
+
+    while (i < n)
+    {
+        // Skip unchanged bytes eight at a time where possible.
+        while (i + 8 <= n && memcmp(pa + i, pb + i, 8) == 0)
+            i += 8;
+        while (i < n && pa[i] == pb[i])
+            i++;
+        if (i >= n)
+            break;
+
+        uint32_t start = i;
+        uint32_t gap = 0;
+        while (i < n && gap < 4 && i - start < 0xFFFF)
+        {
+            gap = (pa[i] == pb[i]) ? gap + 1 : 0;
+            i++;
+        }
+        uint32_t len = i - start - gap;
+        uint32_t skip = start - last_end;
+
+        // Long skips are split so they fit in 16 bits.
+        while (skip > 0xFFFF)
+        {
+            uint16_t s = 0xFFFF, l = 0;
+            memcpy(out + written, &s, 2);
+            memcpy(out + written + 2, &l, 2);
+            written += 4;
+            skip -= 0xFFFF;
+        }
+        uint16_t s = (uint16_t)skip, l = (uint16_t)len;
+        memcpy(out + written, &s, 2);
+        memcpy(out + written + 2, &l, 2);
+        written += 4;
+        for (uint32_t k = 0; k < len; ++k)
+            out[written + k] = pa[start + k] ^ pb[start + k];
+        written += len;
+        last_end = start + len;
+    }
+    return written;
+}
+
+void applySnapshotDelta(GameSnapshot &target, const unsigned char *in, uint32_t size)
+{
+    unsigned char *p = reinterpret_cast<unsigned char *>(&target);
+    uint32_t pos = 0;
+    uint32_t read = 0;
+    while (read + 4 <= size)
+    {
+        uint16_t skip, len;
+        memcpy(&skip, in + read, 2);
+        memcpy(&len, in + read + 2, 2);
+        read += 4;
+        pos += skip;
+        for (uint32_t k = 0; k < len; ++k)
+            p[pos + k] ^= in[read + k];
+        pos += len;
+        read += len;
+    }
+}
+
+void clearSnapshotRing(SnapshotRing &ring)
+{
+    ring.oldest = 0;
+    ring.count = 0;
+    ring.write_offset = 0;
+    memset(&ring.current, 0, sizeof(GameSnapshot));
+}
+
+// Drops the oldest delta. The next-oldest delta still rewinds to a valid
+// state, it just becomes the new limit of how far back we can go.
+void evictOldestSnapshot(SnapshotRing &ring)
+{
+    ring.oldest = (ring.oldest + 1) % SNAPSHOT_RING_SLOTS;
+    ring.count--;
+}
+
+void pushSnapshot(SnapshotRing &ring, const GameSnapshot &snap)
+{
+    uint32_t size = encodeSnapshotDelta(snap, ring.current, ring.scratch);
+    ring.current = snap;
+
+    if (size == 0 && ring.count > 0)
+    {
+        return; // Nothing changed since the last tick, no need to store it
+    }
+
+    if (ring.write_offset + size > SNAPSHOT_RING_BYTES)
+    {
+        ring.write_offset = 0;
+    }
+
+    // Evict any older deltas whose bytes we are about to overwrite.
+    uint32_t begin = ring.write_offset;
+    uint32_t end = begin + size;
+    while (ring.count > 0)
+    {
+        const SnapshotDelta &old = ring.deltas[ring.oldest];
+        bool overlaps = old.offset < end && begin < old.offset + old.size;
+        if (!overlaps && ring.count < SNAPSHOT_RING_SLOTS)
+            break;
+        evictOldestSnapshot(ring);
+    }
+
+    int slot = (ring.oldest + ring.count) % SNAPSHOT_RING_SLOTS;
+    ring.deltas[slot] = {begin, size};
+    memcpy(ring.bytes + begin, ring.scratch, size);
+    ring.write_offset = end;
+    ring.count++;
+}
+
+// Steps the history back by up to `steps` snapshots and returns how many it
+// actually rewound. The first delta ever pushed is relative to an empty
+// state, so we always keep at least one entry.
+int rewindSnapshots(SnapshotRing &ring, int steps)
+{
+    int done = 0;
+    while (done < steps && ring.count > 1)
+    {
+        int slot = (ring.oldest + ring.count - 1) % SNAPSHOT_RING_SLOTS;
+        const SnapshotDelta &d = ring.deltas[slot];
+        applySnapshotDelta(ring.current, ring.bytes + d.offset, d.size);
+        ring.write_offset = d.offset;
+        ring.count--;
+        done++;
+    }
+    return done;
+}
+
+bool isOnMap(int x, int y)
+{
+    return x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT;
+}
+
+// The fields a loaded snapshot indexes the map and world table with. A
+// truncated or edited save is refused rather than trusted.
+bool isSnapshotInBounds(const GameSnapshot &snap)
+{
+    if (snap.magic != SNAPSHOT_MAGIC || snap.version != SNAPSHOT_VERSION || snap.enemy_count != MAX_ENEMIES)
+        return false;
+    if (snap.current_world < 0 || snap.current_world >= WORLD_COUNT || !isOnMap(snap.player_x, snap.player_y))
+        return false;
+    if (snap.facing_x < -1 || snap.facing_x > 1 || snap.facing_y < -1 || snap.facing_y > 1 || snap.enemy_move_throttle < 0)
+        return false;
+    for (const SnapshotNPC &e : snap.enemies)
+    {
+        if (!isOnMap(e.x, e.y))
+            return false;
+        if ((e.goal_x != -1 && !isOnMap(e.goal_x, e.goal_y)) || (e.home_x != -1 && !isOnMap(e.home_x, e.home_y)))
+            return false;
+    }
+    return true;
+}
+
+// A snapshot from a file is checked field by field before anything indexes
+// with it.
+bool isSnapshotValid(const GameSnapshot &snap)
+{
+    return isSnapshotInBounds(snap) && isStingerPoolValid(snap.stingers) && isTimerWheelValid(snap.timers) &&
+           isAiLodValid(snap.ai_lod);
+}
+
+bool saveSnapshotToFile(const GameSnapshot &snap, const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(&snap, sizeof(GameSnapshot), 1, f) == 1;
+    fclose(f);
+    return ok;
+}
+
+bool loadSnapshotFromFile(GameSnapshot &snap, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    GameSnapshot loaded;
+    bool ok = fread(&loaded, sizeof(GameSnapshot), 1, f) == 1 && isSnapshotValid(loaded);
+    fclose(f);
+    if (ok)
+        snap = loaded;
+    return ok;
+}
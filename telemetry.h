@@ -0,0 +1,201 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+// Gameplay telemetry: a typed event log for diagnostics.
+// Events are fixed-size records pushed by the game thread into a
+// single-producer single-consumer ring; a background thread flushes them to
+// a binary file in batches. Logging an event is a clock read and a 24-byte
+// store, and does nothing at all unless a log is open (--telemetry <file>).
+// Read the file with telemetryDecoder.cpp. Telemetry is output only: it
+// never feeds back into the game, so replays are unaffected by it.
+// If the flusher falls behind and the ring fills up, events are dropped,
+// never waited for. The next event that fits is preceded by a TEL_DROPPED
+// event saying how many went missing there, and closing the log writes one
+// for any still unreported, so a log with gaps says so.
+const uint32_t TELEMETRY_MAGIC = 0x4C544B52; // "RKTL"
+const uint16_t TELEMETRY_VERSION = 1;
+const uint32_t TELEMETRY_RING_EVENTS = 8192; // Must be a power of two
+const int TELEMETRY_FLUSH_MS = 20;
+const int FRAME_BUDGET_US = 16667; // Frames slower than this are logged as overruns
+
+enum TelemetryEventType : uint8_t
+{
+    TEL_SPAWN = 1,     // subject: enemy, value: world
+    TEL_DEATH,         // subject: enemy
+    TEL_COLLISION,     // subject: enemy that reached the player
+    TEL_LEVEL,         // subject: world left, value: world entered
+    TEL_FRAME_OVERRUN, // value: frame time in microseconds
+    TEL_DROPPED,       // value: events dropped just before this one, the ring being full
+    TEL_EVENT_TYPES
+};
+
+const char *const TELEMETRY_EVENT_NAMES[TEL_EVENT_TYPES] = {"?", "spawn", "death", "collision", "level", "frame-overrun", "dropped"};
+
+struct TelemetryEvent
+{
+    uint64_t time_ns; // Since the log was opened
+    uint32_t tick;    // GameState::tick when it happened
+    uint8_t type;
+    uint8_t subject;
+    int16_t x;
+    int16_t y;
+    uint16_t reserved;
+    int32_t value;
+};
+
+static_assert(sizeof(TelemetryEvent) == 24, "TelemetryEvent is written to disk as is");
+
+struct TelemetryFileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t event_size;
+    int64_t start_unix_ms; // Wall clock when the log was opened
+};
+
+struct TelemetryLog
+{
+    FILE *file = nullptr;
+    bool active = false; // Only the game thread reads this
+    std::thread flusher;
+    std::atomic<bool> running{false};
+    std::chrono::steady_clock::time_point started;
+
+    TelemetryEvent ring[TELEMETRY_RING_EVENTS];
+    std::atomic<uint64_t> head{0}; // Written by the game thread
+    std::atomic<uint64_t> tail{0}; // Written by the flusher
+    uint64_t dropped = 0;    // Since the log was opened
+    uint32_t unreported = 0; // Dropped since the last TEL_DROPPED event
+
+    ~TelemetryLog();
+};
+
+TelemetryLog telemetry;
+thread_local uint32_t telemetry_tick = 0; // Set by the simulation each tick so events can be placed in it
+
+void fillEvent(const TelemetryLog &t, TelemetryEvent &e, TelemetryEventType type, int subject, int x, int y, int value)
+{
+    e.time_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t.started).count();
+    e.tick = telemetry_tick;
+    e.type = type;
+    e.subject = (uint8_t)subject;
+    e.x = (int16_t)x;
+    e.y = (int16_t)y;
+    e.reserved = 0;
+    e.value = value;
+}
+
+// Returns false, storing nothing, if the ring is full.
+bool pushEvent(TelemetryLog &t, TelemetryEventType type, int subject, int x, int y, int value)
+{
+    uint64_t head = t.head.load(std::memory_order_relaxed);
+    if (head - t.tail.load(std::memory_order_acquire) == TELEMETRY_RING_EVENTS)
+        return false;
+    fillEvent(t, t.ring[head & (TELEMETRY_RING_EVENTS - 1)], type, subject, x, y, value);
+    t.head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void logEvent(TelemetryLog &t, TelemetryEventType type, int subject, int x, int y, int value)
+{
+    if (!t.active)
+        return;
+    if (t.unreported > 0 && pushEvent(t, TEL_DROPPED, 0, 0, 0, (int)t.unreported))
+        t.unreported = 0;
+    if (t.unreported > 0 || !pushEvent(t, type, subject, x, y, value))
+    {
+        t.dropped++;
+        t.unreported++;
+    }
+}
+
+// Writes everything in the ring, in at most two contiguous pieces.
+void flushTelemetry(TelemetryLog &t)
+{
+    uint64_t tail = t.tail.load(std::memory_order_relaxed);
+    uint64_t head = t.head.load(std::memory_order_acquire);
+    while (tail != head)
+    {
+        uint32_t start = (uint32_t)(tail & (TELEMETRY_RING_EVENTS - 1));
+        uint32_t count = (uint32_t)(head - tail);
+        if (count > TELEMETRY_RING_EVENTS - start)
+            count = TELEMETRY_RING_EVENTS - start;
+        fwrite(&t.ring[start], sizeof(TelemetryEvent), count, t.file);
+        tail += count;
+        t.tail.store(tail, std::memory_order_release);
+    }
+}
+
+void runTelemetryFlusher(TelemetryLog *t)
+{
+    while (true)
+    {
+        bool stopping = !t->running.load(std::memory_order_acquire);
+        flushTelemetry(*t);
+        if (stopping)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(TELEMETRY_FLUSH_MS));
+    }
+    fflush(t->file);
+}
+
+bool openTelemetry(TelemetryLog &t, const char *path)
+{
+    t.file = fopen(path, "wb");
+    if (!t.file)
+        return false;
+    TelemetryFileHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = TELEMETRY_MAGIC;
+    h.version = TELEMETRY_VERSION;
+    h.event_size = sizeof(TelemetryEvent);
+    h.start_unix_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    fwrite(&h, sizeof(h), 1, t.file);
+
+    t.head.store(0);
+    t.tail.store(0);
+    t.dropped = 0;
+    t.unreported = 0;
+    t.started = std::chrono::steady_clock::now();
+    t.running.store(true, std::memory_order_release);
+    t.flusher = std::thread(runTelemetryFlusher, &t);
+    t.active = true;
+    return true;
+}
+
+void closeTelemetry(TelemetryLog &t)
+{
+    if (!t.file)
+        return;
+    t.active = false;
+    t.running.store(false, std::memory_order_release);
+    if (t.flusher.joinable())
+        t.flusher.join();
+    if (t.unreported > 0)
+    {
+        // The flusher has stopped, so this one goes straight to the file.
+        TelemetryEvent e;
+        fillEvent(t, e, TEL_DROPPED, 0, 0, 0, (int)t.unreported);
+        fwrite(&e, sizeof(e), 1, t.file);
+        t.unreported = 0;
+    }
+    fclose(t.file);
+    t.file = nullptr;
+}
+
+// Called on exit, after the console is restored.
+void printTelemetryReport(const TelemetryLog &t, FILE *out)
+{
+    if (t.dropped > 0)
+        fprintf(out, "Telemetry: %llu events dropped (ring full); the log marks where\n", (unsigned long long)t.dropped);
+}
+
+TelemetryLog::~TelemetryLog()
+{
+    closeTelemetry(*this);
+}
@@ -0,0 +1,104 @@
+// Prints a telemetry log written with --telemetry <file>, one event per line,
+// followed by a count of each event type and a warning if events were
+// dropped.
+//   g++ -std=c++20 telemetryDecoder.cpp -o telemetryDecoder
+//   telemetryDecoder session.rktl [--summary]
+#include "telemetry.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+int main(int argc, char const *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <telemetry file> [--summary]\n", argv[0]);
+        return 2;
+    }
+    bool summaryOnly = argc > 2 && strcmp(argv[2], "--summary") == 0;
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f)
+    {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 2;
+    }
+
+    TelemetryFileHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != TELEMETRY_MAGIC)
+    {
+        fprintf(stderr, "%s is not a telemetry log\n", argv[1]);
+        fclose(f);
+        return 1;
+    }
+    if (h.version != TELEMETRY_VERSION || h.event_size != sizeof(TelemetryEvent))
+    {
+        fprintf(stderr, "%s is version %u (event size %u); this decoder reads version %u\n",
+                argv[1], h.version, h.event_size, TELEMETRY_VERSION);
+        fclose(f);
+        return 1;
+    }
+
+    time_t start = (time_t)(h.start_unix_ms / 1000);
+    char when[64];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&start));
+    printf("Telemetry log started %s\n", when);
+
+    unsigned long long counts[TEL_EVENT_TYPES] = {};
+    unsigned long long total = 0;
+    int worstOverrun = 0;
+    unsigned long long dropped = 0;
+    TelemetryEvent e;
+    while (fread(&e, sizeof(e), 1, f) == 1)
+    {
+        int type = e.type < TEL_EVENT_TYPES ? e.type : 0;
+        counts[type]++;
+        total++;
+        if (type == TEL_FRAME_OVERRUN && e.value > worstOverrun)
+            worstOverrun = e.value;
+        if (type == TEL_DROPPED && e.value > 0)
+            dropped += (unsigned long long)e.value;
+        if (summaryOnly)
+            continue;
+
+        printf("%12.6f  tick %8u  %-13s", e.time_ns / 1e9, e.tick, TELEMETRY_EVENT_NAMES[type]);
+        switch (type)
+        {
+        case TEL_SPAWN:
+            printf("  enemy %u at (%d, %d) in world %d\n", e.subject, e.x, e.y, e.value);
+            break;
+        case TEL_DEATH:
+            printf("  enemy %u at (%d, %d)\n", e.subject, e.x, e.y);
+            break;
+        case TEL_COLLISION:
+            printf("  enemy %u caught the player at (%d, %d)\n", e.subject, e.x, e.y);
+            break;
+        case TEL_LEVEL:
+            printf("  world %u -> %d, left from (%d, %d)\n", e.subject, e.value, e.x, e.y);
+            break;
+        case TEL_FRAME_OVERRUN:
+            printf("  %d us (budget %d us)\n", e.value, FRAME_BUDGET_US);
+            break;
+        case TEL_DROPPED:
+            printf("  %d events lost before this point\n", e.value);
+            break;
+        default:
+            printf("  type %u\n", e.type);
+            break;
+        }
+    }
+    fclose(f);
+
+    printf("%llu events\n", total);
+    for (int t = 1; t < TEL_EVENT_TYPES; t++)
+    {
+        printf("  %-13s %llu\n", TELEMETRY_EVENT_NAMES[t], counts[t]);
+    }
+    if (counts[0])
+        printf("  %-13s %llu\n", "unknown", counts[0]);
+    if (worstOverrun)
+        printf("Worst frame: %d us\n", worstOverrun);
+    if (dropped)
+        printf("Warning: %llu events were dropped; the log is incomplete\n", dropped);
+    return 0;
+}
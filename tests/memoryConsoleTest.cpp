@@ -0,0 +1,109 @@
+// Plays the whole game, title screen to quit prompt, on the memory console
+// with a scripted player, and checks what came out: the run ends, the game
+// loop never allocates once warmed up, and the session cast is well formed.
+// Also checks that over-aligned allocations are tracked.
+// Run from the repository root; exits non-zero on failure.
+//   g++ -std=c++20 -pthread -DROCKY_CONSOLE_MEMORY -DROCKY_TRACK_ALLOCS tests/memoryConsoleTest.cpp -o memoryConsoleTest
+#define main rockyMain
+#include "../game.cpp"
+#undef main
+
+#include <cstdio>
+#include <string>
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+    printf("%s  %s\n", ok ? "ok  " : "FAIL", what);
+    failures += ok ? 0 : 1;
+}
+
+// Space on the title screen, any key to skip the intro, then a walk with
+// stinger throws and a visit to the pause menu. '_' is a frame with no key.
+// When the script is used up the memory console quits the game by itself.
+string playerScript()
+{
+    string keys = "  ";
+    for (int i = 0; i < 40; i++)
+        keys += "d_e_w___d_s___a_";
+    keys += "p__p";
+    for (int i = 0; i < 20; i++)
+        keys += "dd__ss__";
+    return keys;
+}
+
+// Over-aligned types go through the align_val_t operator new.
+struct alignas(64) CacheLine
+{
+    char bytes[64];
+};
+
+CacheLine *alignedLine;
+
+// Each event line is [time, "o" or "r", "..."], with times that never go back.
+bool checkCast(const char *path, int &events)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    static char line[1 << 20];
+    bool ok = fgets(line, sizeof(line), f) && strstr(line, "\"version\": 2");
+    double last = 0;
+    events = 0;
+    while (ok && fgets(line, sizeof(line), f))
+    {
+        double t;
+        char type;
+        ok = sscanf(line, "[%lf, \"%c\", \"", &t, &type) == 2 && t >= last && (type == 'o' || type == 'r');
+        last = t;
+        events++;
+    }
+    fclose(f);
+    return ok && events > 0;
+}
+
+int main()
+{
+    const char *castPath = "memoryConsoleTest.cast";
+    string keys = playerScript();
+    const char *args[] = {"rocky", "--keys", keys.c_str(), "--cast", castPath};
+
+    FILE *save = fopen(QUICKSAVE_PATH, "rb"); // Only tidy up a save the run made itself
+    bool hadSave = save != nullptr;
+    if (save)
+        fclose(save);
+
+    auto start = chrono::steady_clock::now();
+    int result = rockyMain(5, args);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    check(result == 0, "the game quits when the script runs out");
+    check(session_tick > 300, "the game loop ran the scripted frames");
+    uint64_t loopAllocs = 0;
+    for (int s = ALLOC_STAGE_INPUT; s < ALLOC_STAGE_COUNT; s++)
+        loopAllocs += allocStats.total[s].count.load();
+    check(loopAllocs == 0, "no allocations in the input, simulation, effects or render stages");
+    check(MemoryConsole::bytes_written > 0, "output went to the memory console");
+
+    uint64_t allocs = allocStats.frame[ALLOC_STAGE_OTHER].count.load(), frees = allocStats.frees.load();
+    bool aligned;
+    {
+        AllocationsAllowed allowed; // The guard is still armed from the game loop
+        alignedLine = new CacheLine;
+        aligned = (uintptr_t)alignedLine % alignof(CacheLine) == 0;
+        delete alignedLine;
+    }
+    check(aligned && allocStats.frame[ALLOC_STAGE_OTHER].count.load() == allocs + 1 && allocStats.frees.load() == frees + 1,
+          "over-aligned allocations are aligned and counted");
+
+    int events = 0;
+    check(checkCast(castPath, events), "the cast is asciicast v2 with ordered timestamps");
+    remove(castPath);
+    if (!hadSave)
+        remove(QUICKSAVE_PATH);
+
+    printf("%u ticks, %llu writes, %llu bytes, %d cast events in %.2f s\n", session_tick,
+           MemoryConsole::writes, MemoryConsole::bytes_written, events, seconds);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,352 @@
+// Feeds what the renderer writes into a model terminal and checks that the
+// screen ends up showing the frame. Frames change a few cells at a time
+// while the camera wanders, so views pan (scrolling the terminal when it can),
+// and the terminal is resized between runs: exactly the frame's size, bigger
+// (the view is centred) and smaller (the view is clipped). Every mix of
+// terminal capabilities is tried. Exits non-zero on failure.
+//   g++ -std=c++20 -pthread -DROCKY_CONSOLE_MEMORY tests/rendererTest.cpp -o rendererTest
+#include "../renderer.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+    printf("%s  %s\n", ok ? "ok  " : "FAIL", what);
+    failures += ok ? 0 : 1;
+}
+
+// Just enough of a VT100-style terminal for what the renderer sends: cursor
+// moves, CR and LF, REP, ED, scroll regions with SU and SD, and ICH and DCH.
+// Anything else, or a move off the screen, counts as an error; a real
+// terminal would clamp the cursor and hide the mistake.
+struct ModelTerminal
+{
+    int w, h;
+    bool newline_returns;
+    std::vector<std::string> cells;
+    int cx = 0, cy = 0;
+    int top = 0, bottom;
+    char last = ' ';
+    bool wrap_pending = false;
+    int errors = 0;
+
+    ModelTerminal(int cols, int rows, bool onlcr) : w(cols), h(rows), newline_returns(onlcr), cells(rows, std::string(cols, '?')), bottom(rows - 1) {}
+
+    void scrollUp(int n)
+    {
+        for (int k = 0; k < n; k++)
+        {
+            for (int y = top; y < bottom; y++)
+                cells[y] = cells[y + 1];
+            cells[bottom] = std::string(w, ' ');
+        }
+    }
+
+    void scrollDown(int n)
+    {
+        for (int k = 0; k < n; k++)
+        {
+            for (int y = bottom; y > top; y--)
+                cells[y] = cells[y - 1];
+            cells[top] = std::string(w, ' ');
+        }
+    }
+
+    void lineFeed()
+    {
+        if (cy == bottom)
+            scrollUp(1);
+        else if (cy < h - 1)
+            cy++;
+    }
+
+    void put(char c)
+    {
+        if (wrap_pending)
+        {
+            wrap_pending = false;
+            cx = 0;
+            lineFeed();
+        }
+        cells[cy][cx] = c;
+        last = c;
+        if (cx == w - 1)
+            wrap_pending = true;
+        else
+            cx++;
+    }
+
+    void csi(char final, const int *args, int count)
+    {
+        int n = args[0] ? args[0] : 1;
+        wrap_pending = false;
+        switch (final)
+        {
+        case 'H':
+            cy = (args[0] ? args[0] : 1) - 1;
+            cx = (args[1] ? args[1] : 1) - 1;
+            break;
+        case 'A':
+            cy -= n;
+            break;
+        case 'B':
+            cy += n;
+            break;
+        case 'C':
+            cx += n;
+            break;
+        case 'D':
+            cx -= n;
+            break;
+        case 'b':
+            for (int k = 0; k < n; k++)
+                put(last);
+            break;
+        case 'J':
+            if (args[0] != 2)
+                errors++;
+            for (std::string &row : cells)
+                row = std::string(w, ' ');
+            break;
+        case 'r':
+            top = count > 0 ? args[0] - 1 : 0;
+            bottom = count > 1 ? args[1] - 1 : h - 1;
+            if (top < 0 || bottom >= h || top >= bottom)
+                errors++;
+            cx = cy = 0;
+            break;
+        case 'S':
+            scrollUp(n);
+            break;
+        case 'T':
+            scrollDown(n);
+            break;
+        case '@':
+            cells[cy].insert(cx, std::string(n, ' '));
+            cells[cy].resize(w);
+            break;
+        case 'P':
+            cells[cy].erase(cx, n);
+            cells[cy].resize(w, ' ');
+            break;
+        default:
+            errors++;
+        }
+        if (cx < 0 || cy < 0 || cx >= w || cy >= h)
+        {
+            errors++;
+            cx = std::clamp(cx, 0, w - 1);
+            cy = std::clamp(cy, 0, h - 1);
+        }
+    }
+
+    void feed(const char *p, int size)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            char c = p[i];
+            if (c == '\r')
+            {
+                cx = 0;
+                wrap_pending = false;
+            }
+            else if (c == '\n')
+            {
+                wrap_pending = false;
+                if (newline_returns)
+                    cx = 0;
+                lineFeed();
+            }
+            else if (c == '\033')
+            {
+                if (i + 1 >= size || p[++i] != '[')
+                {
+                    errors++;
+                    continue;
+                }
+                int args[4] = {}, count = 0; // count is the number of arguments given
+                bool given = false;
+                while (i + 1 < size && ((p[i + 1] >= '0' && p[i + 1] <= '9') || p[i + 1] == ';'))
+                {
+                    char d = p[++i];
+                    given = true;
+                    if (d == ';')
+                        count++;
+                    else if (count < 4)
+                        args[count] = args[count] * 10 + (d - '0');
+                }
+                if (given)
+                    count++;
+                if (i + 1 >= size)
+                {
+                    errors++;
+                    continue;
+                }
+                csi(p[++i], args, count);
+            }
+            else
+            {
+                put(c);
+            }
+        }
+    }
+};
+
+uint32_t rng = 12345;
+
+uint32_t nextTestRandom()
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+char frame[SCREEN_HEIGHT][WIDTH];
+
+struct RunStats
+{
+    long frames = 0;
+    long wrong_cells = 0; // In the view and not showing the frame
+    long stray_cells = 0; // Outside the view and not blank
+    long pans = 0;
+    long pan_bytes = 0;
+    long idle_bytes = 0; // Sent for frames that didn't change
+    int errors = 0;
+};
+
+// Sends the frame through presentFrame() and into the model terminal.
+void present(Renderer &r, ModelTerminal &term, RunStats &stats, long &bytes)
+{
+    unsigned long long writes = MemoryConsole::writes;
+    presentFrame(r, frame);
+    bytes = 0;
+    if (MemoryConsole::writes != writes)
+    {
+        term.feed(MemoryConsole::output, MemoryConsole::output_size);
+        bytes = MemoryConsole::output_size;
+    }
+    stats.frames++;
+    for (int y = 0; y < term.h; y++)
+    {
+        for (int x = 0; x < term.w; x++)
+        {
+            int fx = x - r.origin_x, fy = y - r.origin_y;
+            bool inView = fx >= 0 && fx < r.view_w && fy >= 0 && fy < r.view_h;
+            if (inView && term.cells[y][x] != frame[fy + r.view_y][fx + r.view_x])
+                stats.wrong_cells++;
+            else if (!inView && term.cells[y][x] != ' ')
+                stats.stray_cells++;
+        }
+    }
+}
+
+// Plays `frames` frames on a cols x rows terminal that starts out full of junk.
+RunStats run(TerminalCaps caps, int cols, int rows, int frames)
+{
+    Renderer &r = renderer;
+    r.caps = caps;
+    resizeRenderer(r, cols, rows);
+    ModelTerminal term(cols, rows, caps.newline_returns);
+    RunStats stats;
+
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+            frame[y][x] = ".. ~^#"[nextTestRandom() % 6];
+    int px = WIDTH / 2, py = SCREEN_HEIGHT / 2;
+    long bytes = 0;
+    for (int f = 0; f < frames; f++)
+    {
+        for (int k = 0; k < 4; k++)
+            frame[nextTestRandom() % SCREEN_HEIGHT][nextTestRandom() % WIDTH] = "xyz~"[nextTestRandom() % 4];
+        if (f % 97 == 0)
+        {
+            // A run of one glyph, for REP
+            int y = nextTestRandom() % SCREEN_HEIGHT;
+            memset(frame[y] + 5, '~', 30);
+        }
+        switch (nextTestRandom() % 6) // The camera drifts east, like a player does
+        {
+        case 0:
+        case 4:
+            px = std::min(px + 1, WIDTH - 1);
+            break;
+        case 1:
+            px = std::max(px - 1, 0);
+            break;
+        case 2:
+            py = std::min(py + 1, SCREEN_HEIGHT - 1);
+            break;
+        case 3:
+            py = std::max(py - 1, 0);
+            break;
+        }
+        if (f % 500 == 499)
+            px = WIDTH / 4; // A jump back, further than a scroll can reach
+
+        int vx = r.view_x, vy = r.view_y;
+        followViewport(r, px, py);
+        present(r, term, stats, bytes);
+        if (vx != r.view_x || vy != r.view_y)
+        {
+            stats.pans++;
+            stats.pan_bytes += bytes;
+        }
+
+        // Unchanged frames cost nothing.
+        present(r, term, stats, bytes);
+        stats.idle_bytes += bytes;
+    }
+    stats.errors = term.errors;
+    return stats;
+}
+
+int main()
+{
+    struct
+    {
+        int cols, rows;
+    } sizes[] = {
+        {WIDTH, SCREEN_HEIGHT},
+        {WIDTH + 11, SCREEN_HEIGHT + 5}, // Centred
+        {60, 20},                        // Clipped both ways
+        {80, SCREEN_HEIGHT + 2},         // Clipped sideways only
+        {WIDTH + 4, 17},                 // Clipped top and bottom only
+    };
+    const int FRAMES = 1500;
+
+    long wrong = 0, stray = 0, idle = 0;
+    int errors = 0;
+    long panBytes[2] = {}, pans[2] = {};
+    for (int c = 0; c < 8; c++)
+    {
+        TerminalCaps caps = {(c & 1) != 0, (c & 2) != 0, (c & 4) != 0};
+        for (auto size : sizes)
+        {
+            RunStats s = run(caps, size.cols, size.rows, FRAMES);
+            wrong += s.wrong_cells;
+            stray += s.stray_cells;
+            idle += s.idle_bytes;
+            errors += s.errors;
+            if (size.cols == 60)
+            {
+                panBytes[caps.has_scroll] += s.pan_bytes;
+                pans[caps.has_scroll] += s.pans;
+            }
+        }
+    }
+
+    check(errors == 0, "only known sequences, and the cursor never leaves the screen");
+    check(wrong == 0, "the view shows the frame after every present");
+    check(stray == 0, "the terminal is blank outside the view");
+    check(idle == 0, "frames that didn't change send nothing");
+    check(pans[0] > 0 && pans[1] > 0 && panBytes[1] * 2 < panBytes[0], "scrolling makes a pan cost less than half a redraw");
+
+    printf("%ld wrong cells, %ld stray cells, %d errors; bytes per pan %.0f scrolled, %.0f redrawn\n", wrong, stray,
+           errors, pans[1] ? (double)panBytes[1] / pans[1] : 0.0, pans[0] ? (double)panBytes[0] / pans[0] : 0.0);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+// Runs a few thousand scripts side by side (waits, walks and key presses)
+// and reports what a runScripts() tick costs. Exits non-zero if a script
+// fails to start or stops early.
+//   g++ -std=c++20 -O2 tests/scriptBenchmark.cpp -o scriptBenchmark
+//   scriptBenchmark [scripts] [ticks]
+#include "../scripts.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+const int BENCH_KEY_TICKS = 10; // A key is pressed this often
+
+ScriptActor actors[SCRIPT_SLOTS];
+long long steps_done = 0;
+
+// Waits a while, walks somewhere, and every fourth one also waits for a key.
+Script wanderer(ScriptScheduler &s, ScriptActor &a, int seed)
+{
+    for (;;)
+    {
+        co_await wait(s, 10 + seed % 50);
+        co_await move_to(s, a, (a.x + 7) % 80, (a.y + 3) % 40);
+        steps_done++;
+        if (seed % 4 == 0)
+            co_await keypress(s);
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    int scripts = argc > 1 ? atoi(argv[1]) : 4000;
+    int ticks = argc > 2 ? atoi(argv[2]) : 10000;
+    if (scripts < 1 || scripts > SCRIPT_SLOTS || ticks < 1)
+    {
+        fprintf(stderr, "usage: %s [scripts, at most %d] [ticks]\n", argv[0], SCRIPT_SLOTS);
+        return 2;
+    }
+
+    std::unique_ptr<ScriptScheduler> s = std::make_unique<ScriptScheduler>();
+    resetScriptScheduler(*s, 10);
+    for (int i = 0; i < scripts; i++)
+    {
+        actors[i].x = i % 80;
+        actors[i].y = i % 40;
+        actors[i].step_ms = 10 + i % 30;
+        if (!startScript(*s, wanderer(*s, actors[i], i)))
+        {
+            fprintf(stderr, "script %d did not start (frame pool or slots full)\n", i);
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < ticks; t++)
+        runScripts(*s, t % BENCH_KEY_TICKS == 0 ? 'k' : 0);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%d scripts, %d ticks: %.2f us per tick, %lld walks finished\n", scripts, ticks, us / ticks, steps_done);
+    int running = s->running;
+    stopScripts(*s);
+    if (running != scripts || steps_done == 0)
+    {
+        fprintf(stderr, "%d of %d scripts still running\n", running, scripts);
+        return 1;
+    }
+    return 0;
+}
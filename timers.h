@@ -0,0 +1,249 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// Hierarchical timing wheel: things that should happen some number of ticks
+// from now (enemy moves, cooldowns, the title card going away, the intro's
+// typewriter). Four levels of 64 slots each cover 2^24 ticks; level 0 holds
+// timers due within 64 ticks, one slot per tick, and each level above holds
+// 64 times coarser slots. Every 64 ticks the next slot up is cascaded down.
+// Slots are intrusive doubly linked lists and each level keeps a bitmask of
+// non-empty slots, so scheduling and cancelling are O(1) and a tick on which
+// nothing fires is a bit test, however many timers are pending.
+//
+// A wheel is plain data with no pointers; the simulation's wheel is copied
+// into snapshots as it is, so it rewinds and replays with everything else.
+// What a timer does is up to the caller: it carries a kind and a value, and
+// advanceTimers() hands each timer that fires to a callback.
+const int TIMER_SLOT_BITS = 6;
+const int TIMER_SLOTS = 1 << TIMER_SLOT_BITS;
+const int TIMER_LEVELS = 4;
+const uint32_t TIMER_MAX_DELAY = (1u << (TIMER_SLOT_BITS * TIMER_LEVELS)) - 1;
+
+typedef uint32_t TimerId; // Index in the low 16 bits, generation above; 0 is never a valid id
+
+struct Timer
+{
+    uint32_t expires; // Tick it fires on
+    uint32_t period;  // Re-armed this many ticks later after firing; 0 for one-shot
+    int32_t value;
+    uint16_t kind;
+    uint16_t generation; // Bumped on every reuse so stale ids don't match
+    int16_t next;        // Slot list (or free list) links
+    int16_t prev;
+    int16_t slot; // Index into heads, -1 when not scheduled
+    int16_t reserved;
+};
+
+template <int Capacity>
+struct TimerWheel
+{
+    static_assert(Capacity < 0x7FFF, "Timer indices are 16 bits");
+
+    uint32_t now; // Next tick to be processed
+    int16_t free_head;
+    int16_t active_count;
+    uint64_t occupied[TIMER_LEVELS];
+    int16_t heads[TIMER_LEVELS * TIMER_SLOTS];
+    Timer timers[Capacity];
+};
+
+template <int Capacity>
+void resetTimers(TimerWheel<Capacity> &w, uint32_t now = 0)
+{
+    memset(&w, 0, sizeof(w));
+    w.now = now;
+    for (int i = 0; i < TIMER_LEVELS * TIMER_SLOTS; i++)
+        w.heads[i] = -1;
+    for (int i = 0; i < Capacity; i++)
+    {
+        w.timers[i].next = (int16_t)(i + 1 < Capacity ? i + 1 : -1);
+        w.timers[i].slot = -1;
+    }
+    w.free_head = 0;
+}
+
+// Links timer i into the slot its expiry falls in, relative to w.now.
+template <int Capacity>
+void linkTimer(TimerWheel<Capacity> &w, int i)
+{
+    Timer &t = w.timers[i];
+    uint32_t delta = t.expires - w.now;
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && delta >= (1u << (TIMER_SLOT_BITS * (level + 1))))
+        level++;
+    int index = (int)((t.expires >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1));
+    int slot = level * TIMER_SLOTS + index;
+
+    t.slot = (int16_t)slot;
+    t.prev = -1;
+    t.next = w.heads[slot];
+    if (t.next >= 0)
+        w.timers[t.next].prev = (int16_t)i;
+    w.heads[slot] = (int16_t)i;
+    w.occupied[level] |= 1ull << index;
+}
+
+template <int Capacity>
+void unlinkTimer(TimerWheel<Capacity> &w, int i)
+{
+    Timer &t = w.timers[i];
+    if (t.prev >= 0)
+        w.timers[t.prev].next = t.next;
+    else
+        w.heads[t.slot] = t.next;
+    if (t.next >= 0)
+        w.timers[t.next].prev = t.prev;
+    if (w.heads[t.slot] < 0)
+        w.occupied[t.slot / TIMER_SLOTS] &= ~(1ull << (t.slot % TIMER_SLOTS));
+    t.slot = -1;
+}
+
+template <int Capacity>
+void freeTimer(TimerWheel<Capacity> &w, int i)
+{
+    w.timers[i].generation++;
+    w.timers[i].next = w.free_head;
+    w.free_head = (int16_t)i;
+    w.active_count--;
+}
+
+// Fires `delay` ticks from now (at least 1), then every `period` ticks if
+// period isn't 0. Returns 0 if the wheel is full.
+template <int Capacity>
+TimerId scheduleTimer(TimerWheel<Capacity> &w, uint32_t delay, uint16_t kind, int32_t value = 0, uint32_t period = 0)
+{
+    if (w.free_head < 0)
+        return 0;
+    int i = w.free_head;
+    Timer &t = w.timers[i];
+    w.free_head = t.next;
+    w.active_count++;
+
+    if (t.generation == 0)
+        t.generation = 1;
+    delay = delay < 1 ? 1 : (delay > TIMER_MAX_DELAY ? TIMER_MAX_DELAY : delay);
+    t.expires = w.now + delay;
+    t.period = period;
+    t.kind = kind;
+    t.value = value;
+    linkTimer(w, i);
+    return ((TimerId)t.generation << 16) | (TimerId)i;
+}
+
+// The timer behind `id`, or nullptr if it has fired (one-shot) or was cancelled.
+template <int Capacity>
+const Timer *findTimer(const TimerWheel<Capacity> &w, TimerId id)
+{
+    int i = (int)(id & 0xFFFF);
+    if (id == 0 || i >= Capacity)
+        return nullptr;
+    const Timer &t = w.timers[i];
+    return t.slot >= 0 && t.generation == (uint16_t)(id >> 16) ? &t : nullptr;
+}
+
+template <int Capacity>
+bool cancelTimer(TimerWheel<Capacity> &w, TimerId id)
+{
+    if (!findTimer(w, id))
+        return false;
+    int i = (int)(id & 0xFFFF);
+    unlinkTimer(w, i);
+    freeTimer(w, i);
+    return true;
+}
+
+// Ticks until `id` fires, 0 if it isn't pending.
+template <int Capacity>
+uint32_t timerRemaining(const TimerWheel<Capacity> &w, TimerId id)
+{
+    const Timer *t = findTimer(w, id);
+    return t ? t->expires - w.now : 0;
+}
+
+// Checks a wheel that came from outside, such as a save file: every index
+// in range, every timer either free or on the list of the slot it names, and
+// no list that loops. The counts must add up too. A scheduled timer must sit
+// in the slot its expiry falls in, no further ahead than its level reaches,
+// or it would fire late or never.
+template <int Capacity>
+bool isTimerWheelValid(const TimerWheel<Capacity> &w)
+{
+    bool seen[Capacity] = {};
+    int scheduled = 0;
+    for (int slot = 0; slot < TIMER_LEVELS * TIMER_SLOTS; slot++)
+    {
+        bool occupied = (w.occupied[slot / TIMER_SLOTS] >> (slot % TIMER_SLOTS)) & 1;
+        if (occupied != (w.heads[slot] >= 0))
+            return false;
+        int prev = -1;
+        for (int i = w.heads[slot]; i != -1; i = w.timers[i].next)
+        {
+            if (i < 0 || i >= Capacity || seen[i] || w.timers[i].slot != slot || w.timers[i].prev != prev)
+                return false;
+            const Timer &t = w.timers[i];
+            int level = slot / TIMER_SLOTS, shift = TIMER_SLOT_BITS * level;
+            if ((int)((t.expires >> shift) & (TIMER_SLOTS - 1)) != slot % TIMER_SLOTS ||
+                t.expires - w.now >= (1u << (shift + TIMER_SLOT_BITS)) || t.period > TIMER_MAX_DELAY)
+                return false;
+            seen[i] = true;
+            prev = i;
+            scheduled++;
+        }
+    }
+    int free = 0;
+    for (int i = w.free_head; i != -1; i = w.timers[i].next)
+    {
+        if (i < 0 || i >= Capacity || seen[i] || w.timers[i].slot != -1)
+            return false;
+        seen[i] = true;
+        free++;
+    }
+    return scheduled == w.active_count && scheduled + free == Capacity;
+}
+
+// Processes tick w.now: cascades coarser slots down when a level wraps, then
+// fires everything due, in no particular order. onFire(const Timer &) may
+// schedule and cancel timers freely.
+template <int Capacity, typename OnFire>
+void advanceTimers(TimerWheel<Capacity> &w, OnFire onFire)
+{
+    for (int level = 1; level < TIMER_LEVELS; level++)
+    {
+        int shift = TIMER_SLOT_BITS * level;
+        if (w.now & ((1u << shift) - 1))
+            break; // The level below hasn't wrapped
+        int index = (int)((w.now >> shift) & (TIMER_SLOTS - 1));
+        if (!(w.occupied[level] & (1ull << index)))
+            continue;
+        int slot = level * TIMER_SLOTS + index;
+        int i = w.heads[slot];
+        w.heads[slot] = -1;
+        w.occupied[level] &= ~(1ull << index);
+        while (i >= 0)
+        {
+            int next = w.timers[i].next;
+            linkTimer(w, i);
+            i = next;
+        }
+    }
+
+    int index = (int)(w.now & (TIMER_SLOTS - 1));
+    while (w.occupied[0] & (1ull << index))
+    {
+        int i = w.heads[index];
+        unlinkTimer(w, i);
+        Timer fired = w.timers[i];
+        if (fired.period)
+        {
+            w.timers[i].expires = w.now + fired.period;
+            linkTimer(w, i);
+        }
+        else
+        {
+            freeTimer(w, i);
+        }
+        onFire(fired);
+    }
+    w.now++;
+}